@@ -1,16 +1,40 @@
 #include <iostream>
 #include <vector>
 #include <list>
+#include <deque>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
+#include <exception>
 #include <cctype>
 #include <random>
 #include <iomanip>
 #include <cmath>
 #include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <type_traits>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <tuple>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define HAVE_AVX2 1
+#include <immintrin.h>
+#endif
 
 
 #ifdef _WIN32
@@ -23,713 +47,4530 @@ void setupConsole() {
 void setupConsole() {}
 #endif
 
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-std::string readFileToString(const std::string& filepath) {
-    std::ifstream file(filepath, std::ios::in | std::ios::binary);
-    if (!file.is_open()) {
-        throw std::runtime_error("Не удалось открыть файл: " + filepath);
-    }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
 
-std::vector<std::string> processTextToWords(const std::string& text_utf8) {
-    std::vector<std::string> words;
-    std::string current_word;
+// Файл только для чтения, отображенный в память: view() - байты файла без копирования, открытие
+// не зависит от размера файла. Без mmap (Windows), а также для пустых файлов и каналов содержимое читается в буфер.
+class MappedFile {
+private:
+    const char* mapped_data;
+    size_t mapped_size;
+    bool is_mapped;
+    std::string buffer;
+
+    void readIntoBuffer(const std::string& filepath) {
+        std::ifstream file(filepath, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Не удалось открыть файл: " + filepath);
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        buffer = contents.str();
+        mapped_data = buffer.data();
+        mapped_size = buffer.size();
+    }
 
-    for (char c_byte : text_utf8) {
-        unsigned char u_c_byte = static_cast<unsigned char>(c_byte);
-        if (std::isspace(u_c_byte) || std::ispunct(u_c_byte)) {
-            if (!current_word.empty()) {
-                words.push_back(current_word);
-                current_word.clear();
+public:
+    explicit MappedFile(const std::string& filepath) : mapped_data(nullptr), mapped_size(0), is_mapped(false) {
+#ifdef HAVE_MMAP
+        int fd = open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Не удалось открыть файл: " + filepath);
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+            size_t size = static_cast<size_t>(file_stat.st_size);
+            void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                madvise(address, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+                madvise(address, size, MADV_HUGEPAGE); // подсказка: ядро может отказать для файловых страниц
+#endif
+                mapped_data = static_cast<const char*>(address);
+                mapped_size = size;
+                is_mapped = true;
             }
-        } else {
-            current_word += c_byte;
         }
+        close(fd);
+        if (is_mapped) return;
+#endif
+        readIntoBuffer(filepath);
     }
-    if (!current_word.empty()) {
-        words.push_back(current_word);
-    }
-    return words;
-}
 
-std::string normalizeWordToLower(const std::string& input_str) {
-    std::string result_str;
-    result_str.reserve(input_str.length());
-
-    for (size_t i = 0; i < input_str.length(); ++i) {
-        unsigned char b1 = static_cast<unsigned char>(input_str[i]);
-
-        if (b1 >= 0x41 && b1 <= 0x5A) {
-            result_str += static_cast<char>(std::tolower(b1));
-        } else if (b1 == 0xD0) {
-            if (i + 1 < input_str.length()) {
-                unsigned char b2 = static_cast<unsigned char>(input_str[i+1]);
-                if (b2 >= 0x90 && b2 <= 0x9F) {
-                    result_str += static_cast<char>(0xD0);
-                    result_str += static_cast<char>(b2 + 0x20);
-                } else if (b2 >= 0xA0 && b2 <= 0xAF) {
-                    result_str += static_cast<char>(0xD1);
-                    result_str += static_cast<char>(b2 - 0x20);
-                } else if (b2 == 0x81) {
-                    result_str += static_cast<char>(0xD1);
-                    result_str += static_cast<char>(0x91);
-                } else {
-                    result_str += static_cast<char>(b1);
-                    result_str += static_cast<char>(b2);
-                }
-                i++;
-            } else {
-                result_str += static_cast<char>(b1);
-            }
-        } else {
-            result_str += static_cast<char>(b1);
+    ~MappedFile() {
+#ifdef HAVE_MMAP
+        if (is_mapped) {
+            munmap(const_cast<char*>(mapped_data), mapped_size);
         }
+#endif
     }
-    return result_str;
-}
 
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
 
-namespace DictionaryWithHashTable {
+    std::string_view view() const {
+        return std::string_view(mapped_data, mapped_size);
+    }
 
-struct HashNode {
-    std::string key;
-    int value;
+    bool isMapped() const {
+        return is_mapped;
+    }
 
-    HashNode(std::string k, int v) : key(std::move(k)), value(v) {}
+    // Уже прочитанные страницы [offset, offset + length) можно вытеснить из памяти процесса:
+    // при потоковом чтении большого файла резидентной остается только текущая часть.
+    void releaseRange(size_t offset, size_t length) const {
+#ifdef HAVE_MMAP
+        if (!is_mapped) return;
+        size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = (offset + page_size - 1) / page_size * page_size;
+        size_t end = (offset + length) / page_size * page_size;
+        if (begin < end) {
+            madvise(const_cast<char*>(mapped_data) + begin, end - begin, MADV_DONTNEED);
+        }
+#else
+        (void)offset;
+        (void)length;
+#endif
+    }
 };
 
-class HashTable {
-private:
-    std::vector<std::list<HashNode>> table;
-    size_t num_elements;
-    size_t table_size;
-    static constexpr double MAX_LOAD_FACTOR = 0.75;
+std::string readFileToString(const std::string& filepath) {
+    MappedFile file(filepath);
+    return std::string(file.view());
+}
 
-    size_t hashFunction(const std::string& key) const {
-        size_t hash_val = 0;
-        size_t p = 31;
-        size_t p_pow = 1;
-        for (char c_byte : key) {
-            hash_val = (hash_val + static_cast<unsigned char>(c_byte) * p_pow) % table_size;
-            p_pow = (p_pow * p) % table_size;
-        }
-        return hash_val;
+size_t fileSizeBytes(const std::string& filepath) {
+    std::ifstream file(filepath, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Не удалось открыть файл: " + filepath);
     }
+    return static_cast<size_t>(file.tellg());
+}
 
-    void rehash() {
-        size_t old_table_size = table_size;
-        table_size = table_size * 2 + 1;
-        std::vector<std::list<HashNode>> old_table = std::move(table);
+size_t defaultThreadCount() {
+    unsigned int hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : hw;
+}
 
-        table.assign(table_size, std::list<HashNode>());
-        num_elements = 0;
+// Первое исключение из рабочих потоков; rethrowIfAny() пробрасывает его в вызывающий поток после join.
+class FirstException {
+private:
+    std::mutex mutex;
+    std::exception_ptr error;
 
-        for (size_t i = 0; i < old_table_size; ++i) {
-            for (const auto& node : old_table[i]) {
-                add(node.key, node.value);
-            }
-        }
+public:
+    void capture() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) error = std::current_exception();
     }
 
-public:
-    HashTable(size_t initial_size = 101) : table_size(initial_size), num_elements(0) {
-        if (table_size == 0) table_size = 1;
-        table.resize(table_size);
+    void rethrowIfAny() {
+        if (error) std::rethrow_exception(error);
     }
+};
 
-    void add(const std::string& key, int value) {
-        if (static_cast<double>(num_elements + 1) / table_size >= MAX_LOAD_FACTOR) {
-            rehash();
+// Выполняет task(0) .. task(num_tasks - 1) на num_threads потоках; задачи раздаются через общий атомарный счетчик.
+// Исключение задачи останавливает раздачу новых задач и пробрасывается вызывающему.
+void runParallel(size_t num_tasks, size_t num_threads, const std::function<void(size_t)>& task) {
+    num_threads = std::max<size_t>(1, std::min(num_threads, num_tasks));
+    if (num_threads == 1) {
+        for (size_t i = 0; i < num_tasks; ++i) task(i);
+        return;
+    }
+    std::atomic<size_t> next_task(0);
+    FirstException first_error;
+    auto worker = [&]() {
+        for (size_t i = next_task++; i < num_tasks; i = next_task++) {
+            try {
+                task(i);
+            } catch (...) {
+                first_error.capture();
+                next_task = num_tasks;
+            }
         }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (size_t t = 1; t < num_threads; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& th : threads) {
+        th.join();
+    }
+    first_error.rethrowIfAny();
+}
+
+// Выполняет task(worker, i) для i из [0, num_tasks) на num_threads потоках; worker - номер потока.
+// Задачи заранее делятся между потоками непрерывными диапазонами; поток, опустошивший свою очередь,
+// перехватывает задачи с конца чужих очередей, поэтому неравные по стоимости задачи не задерживают остальных.
+// Исключение задачи останавливает поток, в котором оно возникло, и пробрасывается вызывающему после join.
+void runWorkStealing(size_t num_tasks, size_t num_threads, const std::function<void(size_t, size_t)>& task) {
+    num_threads = std::max<size_t>(1, std::min(num_threads, num_tasks));
+    struct alignas(64) WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+    std::vector<WorkQueue> queues(num_threads);
+    FirstException first_error;
+    for (size_t i = 0; i < num_tasks; ++i) {
+        queues[i * num_threads / num_tasks].tasks.push_back(i);
+    }
 
-        size_t index = hashFunction(key);
-        for (auto& node : table[index]) {
-            if (node.key == key) {
-                node.value = value;
+    auto worker = [&](size_t self) {
+        while (true) {
+            size_t index = 0;
+            bool found = false;
+            {
+                std::lock_guard<std::mutex> lock(queues[self].mutex);
+                if (!queues[self].tasks.empty()) {
+                    index = queues[self].tasks.front();
+                    queues[self].tasks.pop_front();
+                    found = true;
+                }
+            }
+            for (size_t k = 1; !found && k < num_threads; ++k) {
+                WorkQueue& victim = queues[(self + k) % num_threads];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    index = victim.tasks.back();
+                    victim.tasks.pop_back();
+                    found = true;
+                }
+            }
+            // новые задачи не появляются: если все очереди пусты, работа закончена
+            if (!found) return;
+            try {
+                task(self, index);
+            } catch (...) {
+                first_error.capture();
                 return;
             }
         }
-        table[index].emplace_back(key, value);
-        num_elements++;
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (size_t t = 1; t < num_threads; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& th : threads) {
+        th.join();
+    }
+    first_error.rethrowIfAny();
+}
+
+// Разделитель слов - те же байты, что std::isspace/std::ispunct в локали "C":
+// \t \n \v \f \r, пробел и знаки ASCII; байты UTF-8 (>= 0x80) и управляющие символы разделителями не являются.
+constexpr bool isWordSeparator(unsigned char c) {
+    bool is_space = (c >= 0x09 && c <= 0x0D) || c == 0x20;
+    bool is_alnum = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+    bool is_punct = c > 0x20 && c < 0x7F && !is_alnum;
+    return is_space || is_punct;
+}
+
+constexpr size_t TOKENIZER_BLOCK_SIZE = 64;
+
+#ifdef HAVE_SSE2
+// Маска разделителей для 16 байт. Сравнения в SSE2 знаковые: байты >= 0x80 отрицательны
+// и не попадают ни в один из положительных диапазонов.
+inline uint32_t separatorMask16(const char* data) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i folded = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+    __m128i is_space = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x08)), _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x0E)));
+    __m128i is_printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x1F)), _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x7F)));
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x2F)), _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x3A)));
+    __m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8(0x60)), _mm_cmplt_epi8(folded, _mm_set1_epi8(0x7B)));
+    __m128i is_separator = _mm_or_si128(is_space, _mm_andnot_si128(_mm_or_si128(is_digit, is_letter), is_printable));
+    return static_cast<uint32_t>(_mm_movemask_epi8(is_separator));
+}
+#endif
+
+#ifdef HAVE_AVX2
+inline uint32_t separatorMask32(const char* data) {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    __m256i folded = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+    auto in_range = [](__m256i v, char above, char below) {
+        return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(above)), _mm256_cmpgt_epi8(_mm256_set1_epi8(below), v));
+    };
+    __m256i is_space = in_range(bytes, 0x08, 0x0E);
+    __m256i is_printable = in_range(bytes, 0x1F, 0x7F);
+    __m256i is_alnum = _mm256_or_si256(in_range(bytes, 0x2F, 0x3A), in_range(folded, 0x60, 0x7B));
+    __m256i is_separator = _mm256_or_si256(is_space, _mm256_andnot_si256(is_alnum, is_printable));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(is_separator));
+}
+#endif
+
+// Бит i установлен, если data[i] - разделитель; data содержит не меньше TOKENIZER_BLOCK_SIZE байт.
+inline uint64_t separatorMask64(const char* data) {
+#if defined(HAVE_AVX2)
+    return static_cast<uint64_t>(separatorMask32(data)) | (static_cast<uint64_t>(separatorMask32(data + 32)) << 32);
+#elif defined(HAVE_SSE2)
+    return static_cast<uint64_t>(separatorMask16(data)) | (static_cast<uint64_t>(separatorMask16(data + 16)) << 16)
+           | (static_cast<uint64_t>(separatorMask16(data + 32)) << 32) | (static_cast<uint64_t>(separatorMask16(data + 48)) << 48);
+#else
+    uint64_t mask = 0;
+    for (size_t i = 0; i < TOKENIZER_BLOCK_SIZE; ++i) {
+        mask |= static_cast<uint64_t>(isWordSeparator(static_cast<unsigned char>(data[i]))) << i;
+    }
+    return mask;
+#endif
+}
+
+inline unsigned lowestSetBit(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    unsigned n = 0;
+    while ((mask & 1u) == 0) {
+        mask >>= 1;
+        n++;
     }
+    return n;
+#endif
+}
 
-    int* get(const std::string& key) {
-        size_t index = hashFunction(key);
-        for (auto& node : table[index]) {
-            if (node.key == key) {
-                return &node.value;
+// Вызывает visit(word) для каждого слова text по порядку; word - подстрока text, без копирования.
+// Текст классифицируется блоками по 64 байта, границы слов извлекаются из битовой маски разделителей.
+template<typename Visitor>
+void forEachWord(std::string_view text, Visitor&& visit) {
+    const char* data = text.data();
+    size_t size = text.size();
+    size_t word_start = 0;
+    bool in_word = false;
+
+    size_t pos = 0;
+    for (; pos + TOKENIZER_BLOCK_SIZE <= size; pos += TOKENIZER_BLOCK_SIZE) {
+        uint64_t word_bytes = ~separatorMask64(data + pos);
+        uint64_t previous = (word_bytes << 1) | (in_word ? 1u : 0u); // бит i: байт i - 1 принадлежит слову
+        uint64_t starts = word_bytes & ~previous;
+        uint64_t ends = ~word_bytes & previous;
+        for (uint64_t boundaries = starts | ends; boundaries != 0; boundaries &= boundaries - 1) {
+            unsigned bit = lowestSetBit(boundaries);
+            if ((starts >> bit) & 1u) {
+                word_start = pos + bit;
+            } else {
+                visit(std::string_view(data + word_start, pos + bit - word_start));
             }
         }
-        return nullptr;
+        in_word = (word_bytes >> 63) != 0;
     }
 
-    const int* get(const std::string& key) const {
-        size_t index = hashFunction(key);
-        for (const auto& node : table[index]) {
-            if (node.key == key) {
-                return &node.value;
-            }
+    for (; pos < size; ++pos) {
+        bool separator = isWordSeparator(static_cast<unsigned char>(data[pos]));
+        if (!separator && !in_word) {
+            word_start = pos;
+        } else if (separator && in_word) {
+            visit(std::string_view(data + word_start, pos - word_start));
         }
-        return nullptr;
+        in_word = !separator;
     }
+    if (in_word) {
+        visit(std::string_view(data + word_start, size - word_start));
+    }
+}
 
+// Слова как подстроки text: text должен жить дольше результата.
+std::vector<std::string_view> splitTextToWordViews(std::string_view text) {
+    std::vector<std::string_view> words;
+    forEachWord(text, [&words](std::string_view word) { words.push_back(word); });
+    return words;
+}
 
-    bool remove(const std::string& key) {
-        size_t index = hashFunction(key);
-        auto& bucket = table[index];
-        for (auto it = bucket.begin(); it != bucket.end(); ++it) {
-            if (it->key == key) {
-                bucket.erase(it);
-                num_elements--;
-                return true;
-            }
+constexpr size_t STREAM_CHUNK_SIZE = 1 << 20;
+
+// Потоковое чтение: файл читается блоками фиксированного размера, visit_chunk получает текст,
+// оканчивающийся на границе слова; недочитанное слово переносится в начало следующего блока.
+// Память - O(chunk_size + длина самого длинного слова) независимо от размера файла.
+// При наличии mmap блоки - это участки отображения без копирования; пройденные страницы сразу отпускаются.
+// Конец блока text, начинающегося с pos: около chunk_size байт, разрез только по разделителю слов.
+// Слово длиннее блока не разрезается - блок продлевается до его конца.
+size_t findChunkEnd(std::string_view text, size_t pos, size_t chunk_size) {
+    size_t cut = std::min(text.size(), pos + std::max<size_t>(chunk_size, 1));
+    if (cut == text.size()) return cut;
+    size_t limit = cut;
+    while (cut > pos && !isWordSeparator(static_cast<unsigned char>(text[cut - 1]))) {
+        --cut;
+    }
+    if (cut == pos) {
+        cut = limit;
+        while (cut < text.size() && !isWordSeparator(static_cast<unsigned char>(text[cut]))) {
+            ++cut;
         }
-        return false;
     }
+    return cut;
+}
 
-    void clear() {
-        for (auto& bucket : table) {
-            bucket.clear();
+template<typename ChunkVisitor>
+void forEachTextChunkInFile(const std::string& filepath, ChunkVisitor&& visit_chunk, size_t chunk_size = STREAM_CHUNK_SIZE) {
+#ifdef HAVE_MMAP
+    MappedFile mapped(filepath);
+    std::string_view text = mapped.view();
+    for (size_t pos = 0; pos < text.size();) {
+        size_t cut = findChunkEnd(text, pos, chunk_size);
+        visit_chunk(text.substr(pos, cut - pos));
+        mapped.releaseRange(pos, cut - pos);
+        pos = cut;
+    }
+#else
+    std::ifstream file(filepath, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Не удалось открыть файл: " + filepath);
+    }
+    std::vector<char> buffer(std::max<size_t>(chunk_size, 1));
+    size_t carried = 0;
+    while (file) {
+        if (carried == buffer.size()) {
+            buffer.resize(buffer.size() * 2); // слово длиннее блока
         }
-        num_elements = 0;
+        file.read(buffer.data() + carried, static_cast<std::streamsize>(buffer.size() - carried));
+        if (file.bad()) {
+            throw std::runtime_error("Ошибка чтения файла: " + filepath);
+        }
+        size_t filled = carried + static_cast<size_t>(file.gcount());
+        size_t cut = filled;
+        if (file) { // файл не кончился: хвост после последнего разделителя может быть началом слова
+            while (cut > 0 && !isWordSeparator(static_cast<unsigned char>(buffer[cut - 1]))) {
+                --cut;
+            }
+        }
+        if (cut > 0) {
+            visit_chunk(std::string_view(buffer.data(), cut));
+        }
+        carried = filled - cut;
+        std::memmove(buffer.data(), buffer.data() + cut, carried);
     }
+#endif
+}
 
-    void print(std::ostream& os = std::cout) const {
-        os << "{";
-        bool first_item = true;
-        for (const auto& bucket : table) {
-            for (const auto& node : bucket) {
-                if (!first_item) {
-                    os << ", ";
-                }
-                os << "'" << node.key << "': " << node.value;
-                first_item = false;
-            }
+template<typename Visitor>
+void forEachWordInFile(const std::string& filepath, Visitor&& visit, size_t chunk_size = STREAM_CHUNK_SIZE) {
+    forEachTextChunkInFile(filepath, [&visit](std::string_view chunk) { forEachWord(chunk, visit); }, chunk_size);
+}
+
+// Строчные пары для двухбайтовых символов UTF-8 (U+0080..U+07FF): латиница-1 и вся кириллица
+// (U+0400..U+052F). Строчная буква в этих диапазонах тоже двухбайтовая, поэтому длина слова не меняется.
+constexpr std::array<uint16_t, 0x800> buildTwoByteLowercaseTable() {
+    std::array<uint16_t, 0x800> table{};
+    for (uint16_t cp = 0; cp < 0x800; ++cp) {
+        uint16_t lower = cp;
+        if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) {
+            lower = cp + 0x20;                                  // À..Þ, кроме знака ×
+        } else if (cp >= 0x400 && cp <= 0x40F) {
+            lower = cp + 0x50;                                  // Ѐ..Џ
+        } else if (cp >= 0x410 && cp <= 0x42F) {
+            lower = cp + 0x20;                                  // А..Я
+        } else if (cp == 0x4C0) {
+            lower = 0x4CF;                                      // Ӏ (палочка)
+        } else if (cp >= 0x4C1 && cp <= 0x4CE) {
+            lower = (cp % 2 == 1) ? cp + 1 : cp;                // Ӂ..Ӎ: прописные на нечетных местах
+        } else if ((cp >= 0x460 && cp <= 0x481) || (cp >= 0x48A && cp <= 0x4BF) || (cp >= 0x4D0 && cp <= 0x52F)) {
+            lower = (cp % 2 == 0) ? cp + 1 : cp;                // Ѡ..Ҁ, Ҋ..ҿ, Ӑ..ӿ, Ԁ..ԯ: пары "прописная, строчная"
         }
-        os << "}";
+        table[cp] = lower;
     }
+    return table;
+}
 
-    void visualize(std::ostream& os = std::cout) const {
-        os << "Визуализация Хеш-таблицы (размер: " << table_size << ", элементы: " << num_elements << "):" << std::endl;
-        for (size_t i = 0; i < table.size(); ++i) {
-            os << "Корзина [" << i << "]: ";
-            if (table[i].empty()) {
-                os << "<пусто>";
+constexpr std::array<uint16_t, 0x800> TWO_BYTE_LOWERCASE = buildTwoByteLowercaseTable();
+
+// Записывает нормализованное слово в out (не меньше input.size() байт), возвращает его длину.
+// Длина всегда равна input.size(), out может совпадать с input.data() (см. normalizeWordToLowerInPlace).
+// Блоки из 16 ASCII-байт обрабатываются SSE2 целиком, остальное - по таблице TWO_BYTE_LOWERCASE.
+size_t normalizeWordToLowerInto(std::string_view input_str, char* out) {
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(input_str.data());
+    size_t n = input_str.size();
+    size_t i = 0;
+
+    while (i < n) {
+        size_t block_end = n;
+#ifdef HAVE_SSE2
+        if (i + 16 <= n) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            if (_mm_movemask_epi8(bytes) == 0) {
+                __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x40)),
+                                                 _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x5B)));
+                __m128i lowered = _mm_add_epi8(bytes, _mm_and_si128(is_upper, _mm_set1_epi8(0x20)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), lowered);
+                i += 16;
+                continue;
+            }
+            block_end = i + 16;
+        }
+#endif
+        while (i < block_end) {
+            unsigned char b1 = in[i];
+            if (b1 < 0x80) {
+                out[i++] = static_cast<char>((b1 >= 'A' && b1 <= 'Z') ? b1 + 0x20 : b1);
+            } else if (b1 >= 0xC2 && b1 <= 0xDF && i + 1 < n && (in[i + 1] & 0xC0) == 0x80) {
+                uint16_t lower = TWO_BYTE_LOWERCASE[((b1 & 0x1F) << 6) | (in[i + 1] & 0x3F)];
+                out[i] = static_cast<char>(0xC0 | (lower >> 6));
+                out[i + 1] = static_cast<char>(0x80 | (lower & 0x3F));
+                i += 2;
             } else {
-                bool first_in_bucket = true;
-                for (const auto& node : table[i]) {
-                    if (!first_in_bucket) {
-                        os << " -> ";
-                    }
-                    os << "(\"" << node.key << "\": " << node.value << ")";
-                    first_in_bucket = false;
-                }
+                out[i++] = static_cast<char>(b1); // трех- и четырехбайтовые символы и некорректные байты не меняются
             }
-            os << std::endl;
         }
     }
-};
+    return n;
+}
 
-class Dictionary {
-private:
-    HashTable ht;
+// Нормализация в буфере вызывающего, без выделения памяти.
+std::string_view normalizeWordToLowerInPlace(char* word, size_t length) {
+    return std::string_view(word, normalizeWordToLowerInto(std::string_view(word, length), word));
+}
 
-    /*std::string toLowerASCII(std::string s) const {
-        std::transform(s.begin(), s.end(), s.begin(),
-                       [](unsigned char c){ return std::tolower(c); });
-        return s;
-    }*/
-    std::string normalizeWord(const std::string& s) const {
-        return ::normalizeWordToLower(s);
-    }
+std::string normalizeWordToLower(std::string_view input_str) {
+    std::string result_str(input_str);
+    normalizeWordToLowerInPlace(&result_str[0], result_str.size());
+    return result_str;
+}
+
+// Нормализованный ключ для поиска: короткие слова нормализуются в буфер на стеке,
+// поэтому поиск уже существующего слова не выделяет память в куче.
+class NormalizedKey {
+private:
+    static constexpr size_t INLINE_CAPACITY = 128;
+    char inline_buffer[INLINE_CAPACITY];
+    std::string heap_buffer;
+    std::string_view normalized;
 
 public:
-    Dictionary(size_t initial_capacity = 101) : ht(initial_capacity) {}
+    explicit NormalizedKey(std::string_view input_str) {
+        char* out = inline_buffer;
+        if (input_str.length() > INLINE_CAPACITY) {
+            heap_buffer.resize(input_str.length());
+            out = &heap_buffer[0];
+        }
+        normalized = std::string_view(out, normalizeWordToLowerInto(input_str, out));
+    }
 
-    void addWord(const std::string& word_raw) {
-        if (word_raw.empty()) return;
-        //std::string word = toLowerASCII(word_raw);
-        std::string word = normalizeWord(word_raw);
+    NormalizedKey(const NormalizedKey&) = delete;
+    NormalizedKey& operator=(const NormalizedKey&) = delete;
 
+    std::string_view view() const { return normalized; }
+};
 
-        int* current_val_ptr = ht.get(word);
-        if (current_val_ptr) {
-            (*current_val_ptr)++;
-        } else {
-            ht.add(word, 1);
-        }
-    }
+// Оценка памяти кучи под одно выделение size байт: заголовок блока malloc (8 байт в glibc на 64-битных
+// системах) и выравнивание до 16 байт, но не меньше 32. Нужна, чтобы честно сравнивать структуры,
+// выделяющие узлы по одному, со структурами, выделяющими их крупными блоками.
+inline size_t heapAllocationSize(size_t size) {
+    constexpr size_t HEADER = sizeof(size_t);
+    constexpr size_t ALIGNMENT = 2 * sizeof(size_t);
+    constexpr size_t MIN_CHUNK = 4 * sizeof(size_t);
+    return std::max(MIN_CHUNK, (size + HEADER + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+}
 
-    void removeWord(const std::string& word_raw) {
-        if (word_raw.empty()) return;
-        //std::string word = toLowerASCII(word_raw);
-        std::string word = normalizeWord(word_raw);
-        ht.remove(word);
-    }
+// Арена для ключей словарей: байты ключей складываются подряд в крупные блоки,
+// узлы хранят только string_view. Память освобождается целиком в release().
+class StringArena {
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* current;
+    size_t remaining;
+    size_t bytes_reserved;
 
-    bool findWord(const std::string& word_raw) const {
-        if (word_raw.empty()) return false;
-        //std::string word = toLowerASCII(word_raw);
-        std::string word = normalizeWord(word_raw);
+public:
+    StringArena() : current(nullptr), remaining(0), bytes_reserved(0) {}
 
-        const int* count_ptr = ht.get(word);
-        if (count_ptr) {
-            std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') найдено, частота: " << *count_ptr << std::endl;
-            return true;
-        } else {
-            std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') не найдено." << std::endl;
-            return false;
-        }
-    }
+    StringArena(StringArena&&) = default;
+    StringArena& operator=(StringArena&&) = default;
 
-    void clear() {
-        ht.clear();
-        std::cout << "Словарь (хеш-таблица) очищен." << std::endl;
+    std::string_view intern(std::string_view str) {
+        if (str.empty()) return std::string_view();
+        char* memory = allocate(str.size());
+        std::memcpy(memory, str.data(), str.size());
+        return std::string_view(memory, str.size());
     }
 
-    void loadFromFile(const std::string& filepath, bool append = false) {
-        if (!append) {
-            clear();
-        }
-        try {
-            std::string content = readFileToString(filepath);
-            std::vector<std::string> words = processTextToWords(content);
-            for (const std::string& word : words) {
-                if (!word.empty()) addWord(word);
+    // Участок из size байт, выровненный по alignment (степень двойки, не больше выравнивания new[]):
+    // например, заголовок узла вместе с байтами ключа за ним.
+    char* allocate(size_t size, size_t alignment = 1) {
+        size_t padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+        if (padding + size > remaining) {
+            // длинные участки получают собственный блок, чтобы не выбрасывать остаток текущего
+            if (size > BLOCK_SIZE / 4) {
+                blocks.push_back(std::make_unique<char[]>(size));
+                bytes_reserved += size;
+                return blocks.back().get();
             }
-            std::cout << "Словарь загружен/дополнен из файла '" << filepath << "' (хеш-таблица)." << std::endl;
-        } catch (const std::runtime_error& e) {
-            std::cerr << "Ошибка при загрузке из файла (хеш-таблица): " << e.what() << std::endl;
+            blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            bytes_reserved += BLOCK_SIZE;
+            current = blocks.back().get();
+            remaining = BLOCK_SIZE;
+            padding = 0;
         }
+        char* memory = current + padding;
+        current = memory + size;
+        remaining -= padding + size;
+        return memory;
     }
 
-    void print(std::ostream& os = std::cout) const {
-        ht.print(os);
+    void release() {
+        blocks.clear();
+        blocks.shrink_to_fit();
+        current = nullptr;
+        remaining = 0;
+        bytes_reserved = 0;
     }
 
-    void visualizeStructure(std::ostream& os = std::cout) const {
-        ht.visualize(os);
+    size_t bytesReserved() const {
+        return bytes_reserved;
     }
 };
 
+
+namespace DictionaryWithHashTable {
+
+inline uint64_t readWord64(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
 }
 
-namespace DictionaryWithRBTree {
+inline uint64_t readWord32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
 
-enum Color { RED, BLACK };
+inline uint64_t mixMultiply(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+    uint64_t a_lo = a & 0xFFFFFFFFULL, a_hi = a >> 32;
+    uint64_t b_lo = b & 0xFFFFFFFFULL, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFULL) + lo_hi;
+    uint64_t upper = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFFULL);
+    return lower ^ upper;
+#endif
+}
 
-struct Node {
-    std::string key;
+// 64-битный хеш в стиле wyhash: ключ читается словами по 8 байт, без делений.
+inline uint64_t hashBytes(const char* data, size_t len) {
+    const uint64_t SECRET0 = 0xa0761d6478bd642fULL;
+    const uint64_t SECRET1 = 0xe7037ed1a0b428dbULL;
+    uint64_t seed = SECRET0 ^ mixMultiply(len, SECRET1);
+    uint64_t a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t shift = (len >> 3) << 2;
+            a = (readWord32(data) << 32) | readWord32(data + shift);
+            b = (readWord32(data + len - 4) << 32) | readWord32(data + len - 4 - shift);
+        } else if (len > 0) {
+            a = (static_cast<uint64_t>(static_cast<unsigned char>(data[0])) << 16)
+              | (static_cast<uint64_t>(static_cast<unsigned char>(data[len >> 1])) << 8)
+              | static_cast<unsigned char>(data[len - 1]);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        const char* p = data;
+        size_t remaining = len;
+        while (remaining > 16) {
+            seed = mixMultiply(readWord64(p) ^ SECRET1, readWord64(p + 8) ^ seed);
+            p += 16;
+            remaining -= 16;
+        }
+        a = readWord64(p + remaining - 16);
+        b = readWord64(p + remaining - 8);
+    }
+    return mixMultiply(SECRET1 ^ len, mixMultiply(a ^ SECRET1, b ^ seed));
+}
+
+inline size_t hashKey(std::string_view key) {
+    return static_cast<size_t>(hashBytes(key.data(), key.size()));
+}
+
+inline size_t roundUpToPowerOfTwo(size_t n) {
+    size_t result = 1;
+    while (result < n) result <<= 1;
+    return result;
+}
+
+struct HashNode {
+    std::string_view key; // байты ключа лежат в StringArena таблицы
     int value;
-    Color color;
-    Node *parent, *left, *right;
+    size_t hash; // полный хеш ключа: не пересчитывается при rehash и отсекает лишние сравнения строк
 
-    Node(std::string k, int v, Color c = RED, Node* p = nullptr, Node* l = nullptr, Node* r = nullptr)
-        : key(std::move(k)), value(v), color(c), parent(p), left(l), right(r) {}
+    HashNode(std::string_view k, int v, size_t h) : key(k), value(v), hash(h) {}
 };
 
-class RBTree {
+enum class RehashPolicy { StopTheWorld, Incremental };
+
+class HashTable {
 private:
-    Node* root;
-    Node* NIL;
+    std::vector<std::list<HashNode>> table;
+    StringArena key_arena;
+    size_t num_elements;
+    size_t table_size; // всегда степень двойки
+    static constexpr double MAX_LOAD_FACTOR = 0.75;
 
-    void leftRotate(Node* x) {
+    // Инкрементальный rehash: пока migrating == true, часть элементов еще лежит в old_table,
+    // корзины old_table[0 .. migrate_pos) уже перенесены в table.
+    // После переноса пустые корзины old_table тоже разрушаются по шагам, затем по шагам строится
+    // next_table - массив корзин для следующего удвоения, так что ни одна вставка не создает и не
+    // разрушает весь массив сразу. Между удвоениями не меньше 3/8 table_size вставок, а на перенос
+    // и освобождение table_size / 2 корзин и подготовку 2 * table_size хватает меньше table_size / 5 шагов.
+    RehashPolicy rehash_policy;
+    std::vector<std::list<HashNode>> old_table;
+    std::vector<std::list<HashNode>> next_table;
+    size_t migrate_pos;
+    bool migrating;
+    static constexpr size_t REHASH_BUCKETS_PER_STEP = 8;
+    static constexpr size_t PREPARE_BUCKETS_PER_STEP = 16;
+    static constexpr size_t RELEASE_BUCKETS_PER_STEP = 64;
+
+    size_t bucketIndex(size_t hash) const {
+        return hash & (table_size - 1);
+    }
+
+    size_t oldBucketIndex(size_t hash) const {
+        return hash & (old_table.size() - 1);
+    }
+
+    // узлы переносятся splice'ом по сохраненному хешу: без копирования ключей и без аллокаций
+    void moveBucket(std::list<HashNode>& bucket) {
+        while (!bucket.empty()) {
+            auto& target = table[bucketIndex(bucket.front().hash)];
+            target.splice(target.end(), bucket, bucket.begin());
+        }
+    }
+
+    void migrateStep(size_t max_buckets) {
+        if (!migrating) return;
+        size_t end = std::min(old_table.size(), migrate_pos + max_buckets);
+        for (; migrate_pos < end; ++migrate_pos) {
+            moveBucket(old_table[migrate_pos]);
+        }
+        if (migrate_pos == old_table.size()) {
+            migrating = false; // пустые корзины освобождает releaseStep
+        }
+    }
+
+    void releaseStep(size_t max_buckets) {
+        for (size_t i = 0; i < max_buckets && !old_table.empty(); ++i) {
+            old_table.pop_back();
+        }
+        if (old_table.empty() && old_table.capacity() != 0) {
+            std::vector<std::list<HashNode>>().swap(old_table);
+        }
+    }
+
+    void finishMigration() {
+        if (migrating) {
+            migrateStep(old_table.size());
+        }
+        std::vector<std::list<HashNode>>().swap(old_table);
+    }
+
+    // память под next_table берется сразу (reserve не конструирует корзины), корзины создаются по max_buckets
+    void prepareStep(size_t max_buckets) {
+        size_t target = table_size * 2;
+        if (next_table.capacity() < target) {
+            next_table.reserve(target);
+        }
+        size_t end = std::min(target, next_table.size() + max_buckets);
+        while (next_table.size() < end) {
+            next_table.emplace_back();
+        }
+    }
+
+    // Шаг фоновой работы при каждой изменяющей операции: перенос, освобождение старого массива,
+    // затем подготовка следующего.
+    void rehashStep() {
+        if (migrating) {
+            migrateStep(REHASH_BUCKETS_PER_STEP);
+        } else if (old_table.capacity() != 0) {
+            releaseStep(RELEASE_BUCKETS_PER_STEP);
+        } else if (rehash_policy == RehashPolicy::Incremental) {
+            prepareStep(PREPARE_BUCKETS_PER_STEP);
+        }
+    }
+
+    // Явное изменение размера (reserve, shrink_to_fit, StopTheWorld): перенос целиком.
+    void resizeTo(size_t new_table_size) {
+        finishMigration();
+        std::vector<std::list<HashNode>>().swap(next_table);
+        table_size = new_table_size;
+        old_table = std::move(table);
+        table.assign(table_size, std::list<HashNode>());
+        migrate_pos = 0;
+        migrating = true;
+        finishMigration();
+    }
+
+    void rehash() {
+        if (rehash_policy == RehashPolicy::StopTheWorld) {
+            resizeTo(table_size * 2);
+            return;
+        }
+        // Обычно к этому моменту перенос закончен и next_table готов; оба вызова доделывают работу
+        // только после явного shrink_to_fit, который может оставить запас меньше 3/8 table_size.
+        finishMigration();
+        prepareStep(SIZE_MAX);
+        old_table = std::move(table);
+        table = std::move(next_table);
+        next_table = std::vector<std::list<HashNode>>();
+        table_size *= 2;
+        migrate_pos = 0;
+        migrating = true;
+    }
+
+    // минимальный размер таблицы, при котором expected_elements помещаются без rehash
+    static size_t tableSizeFor(size_t expected_elements) {
+        return roundUpToPowerOfTwo(static_cast<size_t>(expected_elements / MAX_LOAD_FACTOR) + 2);
+    }
+
+    HashNode* findNode(std::string_view key, size_t hash) const {
+        for (const auto& node : table[bucketIndex(hash)]) {
+            if (node.hash == hash && node.key == key) {
+                return const_cast<HashNode*>(&node);
+            }
+        }
+        if (migrating) {
+            for (const auto& node : old_table[oldBucketIndex(hash)]) {
+                if (node.hash == hash && node.key == key) {
+                    return const_cast<HashNode*>(&node);
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    bool eraseFromBucket(std::list<HashNode>& bucket, std::string_view key, size_t hash) {
+        for (auto it = bucket.begin(); it != bucket.end(); ++it) {
+            if (it->hash == hash && it->key == key) {
+                bucket.erase(it);
+                num_elements--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    template<typename Visitor>
+    void forEach(Visitor visit) const {
+        for (const auto& bucket : table) {
+            for (const auto& node : bucket) visit(node);
+        }
+        if (migrating) {
+            for (size_t i = migrate_pos; i < old_table.size(); ++i) {
+                for (const auto& node : old_table[i]) visit(node);
+            }
+        }
+    }
+
+    size_t size() const {
+        return num_elements;
+    }
+
+    // Готовит таблицу к expected_elements элементам: дальнейшие вставки до этого числа обходятся без rehash.
+    void reserve(size_t expected_elements) {
+        size_t required = tableSizeFor(expected_elements);
+        if (required > table_size) {
+            resizeTo(required);
+        }
+    }
+
+    void shrink_to_fit() {
+        size_t required = tableSizeFor(num_elements);
+        if (required < table_size) {
+            resizeTo(required);
+        } else {
+            finishMigration();
+        }
+    }
+
+    HashTable(size_t initial_size = 101, RehashPolicy policy = RehashPolicy::Incremental)
+        : num_elements(0), table_size(roundUpToPowerOfTwo(initial_size)),
+          rehash_policy(policy), migrate_pos(0), migrating(false) {
+        table.resize(table_size);
+    }
+
+    void add(std::string_view key, int value) {
+        findOrInsert(key, hashKey(key)) = value;
+    }
+
+    // Один проход по таблице: возвращает значение ключа, при отсутствии вставляет его со значением 0.
+    int& findOrInsert(std::string_view key, size_t hash) {
+        rehashStep();
+        if (HashNode* node = findNode(key, hash)) {
+            return node->value;
+        }
+        if (static_cast<double>(num_elements + 1) / table_size >= MAX_LOAD_FACTOR) {
+            rehash();
+        }
+        auto& bucket = table[bucketIndex(hash)];
+        bucket.emplace_back(key_arena.intern(key), 0, hash);
+        num_elements++;
+        return bucket.back().value;
+    }
+
+    int* get(std::string_view key) {
+        return get(key, hashKey(key));
+    }
+
+    int* get(std::string_view key, size_t hash) {
+        rehashStep();
+        HashNode* node = findNode(key, hash);
+        return node ? &node->value : nullptr;
+    }
+
+    const int* get(std::string_view key) const {
+        return get(key, hashKey(key));
+    }
+
+    const int* get(std::string_view key, size_t hash) const {
+        const HashNode* node = findNode(key, hash);
+        return node ? &node->value : nullptr;
+    }
+
+
+    bool remove(std::string_view key) {
+        rehashStep();
+        size_t hash = hashKey(key);
+        if (eraseFromBucket(table[bucketIndex(hash)], key, hash)) {
+            return true;
+        }
+        return migrating && eraseFromBucket(old_table[oldBucketIndex(hash)], key, hash);
+    }
+
+    void clear() {
+        for (auto& bucket : table) {
+            bucket.clear();
+        }
+        std::vector<std::list<HashNode>>().swap(old_table);
+        migrating = false;
+        num_elements = 0;
+        key_arena.release();
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        os << "{";
+        bool first_item = true;
+        forEach([&](const HashNode& node) {
+            if (!first_item) {
+                os << ", ";
+            }
+            os << "'" << node.key << "': " << node.value;
+            first_item = false;
+        });
+        os << "}";
+    }
+
+    void visualize(std::ostream& os = std::cout) const {
+        os << "Визуализация Хеш-таблицы (размер: " << table_size << ", элементы: " << num_elements
+           << ", память ключей: " << key_arena.bytesReserved() << " байт):" << std::endl;
+        auto printBucket = [&os](const std::list<HashNode>& bucket) {
+            if (bucket.empty()) {
+                os << "<пусто>";
+            } else {
+                bool first_in_bucket = true;
+                for (const auto& node : bucket) {
+                    if (!first_in_bucket) {
+                        os << " -> ";
+                    }
+                    os << "(\"" << node.key << "\": " << node.value << ")";
+                    first_in_bucket = false;
+                }
+            }
+            os << std::endl;
+        };
+        for (size_t i = 0; i < table.size(); ++i) {
+            os << "Корзина [" << i << "]: ";
+            printBucket(table[i]);
+        }
+        if (migrating) {
+            os << "Идет инкрементальный rehash: перенесено " << migrate_pos << " из " << old_table.size()
+               << " корзин старой таблицы." << std::endl;
+            for (size_t i = migrate_pos; i < old_table.size(); ++i) {
+                os << "Старая корзина [" << i << "]: ";
+                printBucket(old_table[i]);
+            }
+        }
+    }
+};
+
+struct FlatSlot {
+    std::string_view key;
+    int value;
+    uint32_t distance; // 0 - ячейка пуста, иначе длина пробы + 1
+    size_t hash;
+
+    FlatSlot() : value(0), distance(0), hash(0) {}
+};
+
+// Хеш-таблица с открытой адресацией (Robin Hood hashing).
+// Элементы лежат непосредственно в массиве ячеек, размер массива - степень двойки.
+class FlatHashTable {
+private:
+    std::vector<FlatSlot> slots;
+    StringArena key_arena;
+    size_t num_elements;
+    size_t capacity_mask;
+    static constexpr double MAX_LOAD_FACTOR = 0.85;
+
+    // возвращает индекс ячейки, в которую попал именно вставляемый ключ
+    size_t insertNew(std::string_view key, int value, size_t hash) {
+        size_t index = hash & capacity_mask;
+        size_t placed_index = slots.size();
+        FlatSlot incoming;
+        incoming.key = key;
+        incoming.value = value;
+        incoming.distance = 1;
+        incoming.hash = hash;
+
+        while (true) {
+            FlatSlot& slot = slots[index];
+            if (slot.distance == 0) {
+                slot = std::move(incoming);
+                num_elements++;
+                return (placed_index == slots.size()) ? index : placed_index;
+            }
+            if (slot.distance < incoming.distance) {
+                std::swap(slot, incoming);
+                if (placed_index == slots.size()) {
+                    placed_index = index;
+                }
+            }
+            incoming.distance++;
+            index = (index + 1) & capacity_mask;
+        }
+    }
+
+    void rehashTo(size_t new_capacity) {
+        std::vector<FlatSlot> old_slots = std::move(slots);
+        slots.assign(new_capacity, FlatSlot());
+        capacity_mask = slots.size() - 1;
+        num_elements = 0;
+
+        for (auto& slot : old_slots) {
+            if (slot.distance != 0) {
+                insertNew(slot.key, slot.value, slot.hash);
+            }
+        }
+    }
+
+    void rehash() {
+        rehashTo(slots.size() * 2);
+    }
+
+    static size_t capacityFor(size_t expected_elements) {
+        return roundUpToPowerOfTwo(std::max<size_t>(static_cast<size_t>(expected_elements / MAX_LOAD_FACTOR) + 2, 8));
+    }
+
+    size_t findIndex(std::string_view key, size_t hash) const {
+        size_t index = hash & capacity_mask;
+        uint32_t distance = 1;
+        while (true) {
+            const FlatSlot& slot = slots[index];
+            // по инварианту Robin Hood искомый ключ не может лежать дальше "более бедной" ячейки
+            if (slot.distance < distance) {
+                return slots.size();
+            }
+            if (slot.distance == distance && slot.hash == hash && slot.key == key) {
+                return index;
+            }
+            distance++;
+            index = (index + 1) & capacity_mask;
+        }
+    }
+
+public:
+    FlatHashTable(size_t initial_size = 101) : num_elements(0) {
+        slots.resize(roundUpToPowerOfTwo(std::max<size_t>(initial_size, 8)));
+        capacity_mask = slots.size() - 1;
+    }
+
+    void add(std::string_view key, int value) {
+        findOrInsert(key, hashKey(key)) = value;
+    }
+
+    int& findOrInsert(std::string_view key, size_t hash) {
+        size_t index = findIndex(key, hash);
+        if (index != slots.size()) {
+            return slots[index].value;
+        }
+        if (static_cast<double>(num_elements + 1) / slots.size() >= MAX_LOAD_FACTOR) {
+            rehash();
+        }
+        return slots[insertNew(key_arena.intern(key), 0, hash)].value;
+    }
+
+    int* get(std::string_view key) {
+        return get(key, hashKey(key));
+    }
+
+    int* get(std::string_view key, size_t hash) {
+        size_t index = findIndex(key, hash);
+        return (index == slots.size()) ? nullptr : &slots[index].value;
+    }
+
+    const int* get(std::string_view key) const {
+        return get(key, hashKey(key));
+    }
+
+    const int* get(std::string_view key, size_t hash) const {
+        size_t index = findIndex(key, hash);
+        return (index == slots.size()) ? nullptr : &slots[index].value;
+    }
+
+    size_t size() const {
+        return num_elements;
+    }
+
+    void reserve(size_t expected_elements) {
+        size_t required = capacityFor(expected_elements);
+        if (required > slots.size()) {
+            rehashTo(required);
+        }
+    }
+
+    void shrink_to_fit() {
+        size_t required = capacityFor(num_elements);
+        if (required < slots.size()) {
+            rehashTo(required);
+        }
+    }
+
+    bool remove(std::string_view key) {
+        size_t index = findIndex(key, hashKey(key));
+        if (index == slots.size()) return false;
+
+        // обратный сдвиг: подтягиваем следующие элементы кластера на одну позицию назад
+        size_t next = (index + 1) & capacity_mask;
+        while (slots[next].distance > 1) {
+            slots[index] = std::move(slots[next]);
+            slots[index].distance--;
+            index = next;
+            next = (next + 1) & capacity_mask;
+        }
+        slots[index] = FlatSlot();
+        num_elements--;
+        return true;
+    }
+
+    void clear() {
+        for (auto& slot : slots) {
+            slot = FlatSlot();
+        }
+        num_elements = 0;
+        key_arena.release();
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        os << "{";
+        bool first_item = true;
+        for (const auto& slot : slots) {
+            if (slot.distance == 0) continue;
+            if (!first_item) {
+                os << ", ";
+            }
+            os << "'" << slot.key << "': " << slot.value;
+            first_item = false;
+        }
+        os << "}";
+    }
+
+    void visualize(std::ostream& os = std::cout) const {
+        os << "Визуализация Хеш-таблицы с открытой адресацией (размер: " << slots.size() << ", элементы: " << num_elements
+           << ", память ключей: " << key_arena.bytesReserved() << " байт):" << std::endl;
+        std::vector<size_t> probe_histogram;
+        size_t total_probe_length = 0;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            os << "Ячейка [" << i << "]: ";
+            if (slots[i].distance == 0) {
+                os << "<пусто>";
+            } else {
+                size_t probe_length = slots[i].distance - 1;
+                os << "(\"" << slots[i].key << "\": " << slots[i].value << ", проба: " << probe_length << ")";
+                if (probe_histogram.size() <= probe_length) {
+                    probe_histogram.resize(probe_length + 1, 0);
+                }
+                probe_histogram[probe_length]++;
+                total_probe_length += probe_length;
+            }
+            os << std::endl;
+        }
+
+        os << "Статистика проб:" << std::endl;
+        if (num_elements == 0) {
+            os << "  <нет элементов>" << std::endl;
+            return;
+        }
+        os << "  Коэффициент заполнения: " << std::fixed << std::setprecision(2)
+           << static_cast<double>(num_elements) / slots.size() << std::endl;
+        os << "  Средняя длина пробы: " << static_cast<double>(total_probe_length) / num_elements << std::endl;
+        os << "  Максимальная длина пробы: " << probe_histogram.size() - 1 << std::endl;
+        for (size_t len = 0; len < probe_histogram.size(); ++len) {
+            if (probe_histogram[len] > 0) {
+                os << "  проба " << len << ": " << probe_histogram[len] << " эл." << std::endl;
+            }
+        }
+    }
+};
+
+// Оценка числа различных ключей (HyperLogLog, 2^14 регистров, погрешность ~1%).
+class HyperLogLog {
+private:
+    static constexpr unsigned int PRECISION = 14;
+    static constexpr size_t NUM_REGISTERS = static_cast<size_t>(1) << PRECISION;
+    std::vector<uint8_t> registers;
+
+public:
+    HyperLogLog() : registers(NUM_REGISTERS, 0) {}
+
+    void add(std::string_view key) {
+        addHash(hashBytes(key.data(), key.size()));
+    }
+
+    void addHash(uint64_t hash) {
+        size_t index = static_cast<size_t>(hash >> (64 - PRECISION));
+        uint64_t rest = (hash << PRECISION) | (static_cast<uint64_t>(1) << (PRECISION - 1));
+        uint8_t rank = 1;
+        while ((rest & (static_cast<uint64_t>(1) << 63)) == 0) {
+            rank++;
+            rest <<= 1;
+        }
+        registers[index] = std::max(registers[index], rank);
+    }
+
+    size_t estimate() const {
+        const double m = static_cast<double>(NUM_REGISTERS);
+        double sum = 0.0;
+        size_t zero_registers = 0;
+        for (uint8_t r : registers) {
+            sum += std::ldexp(1.0, -static_cast<int>(r));
+            if (r == 0) zero_registers++;
+        }
+        double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+        if (estimate <= 2.5 * m && zero_registers > 0) {
+            estimate = m * std::log(m / static_cast<double>(zero_registers));
+        }
+        return static_cast<size_t>(estimate + 0.5);
+    }
+};
+
+constexpr size_t INGEST_CHUNK_SIZE = 4 * STREAM_CHUNK_SIZE;
+
+// Подсчет частот слов набора файлов на num_threads потоках (0 - по числу ядер) по схеме map-reduce.
+// map: файлы режутся на блоки по границам слов, блоки раздаются потокам с перехватом работы,
+// каждый поток считает в собственную HashTable без блокировок.
+// reduce: локальные таблицы параллельно сводятся по разделам (старшие биты хеша). Ключи разных
+// разделов не пересекаются, поэтому результат можно вливать в словарь без дополнительного слияния.
+std::vector<HashTable> countWordsInFilesParallel(const std::vector<std::string>& filepaths, size_t num_threads = 0) {
+    if (num_threads == 0) num_threads = defaultThreadCount();
+
+    struct ChunkTask {
+        size_t file;
+        size_t begin;
+        size_t end;
+    };
+    // все файлы открываются до подсчета: ошибка открытия прерывает загрузку, не оставляя частичного результата
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<ChunkTask> tasks;
+    for (const std::string& filepath : filepaths) {
+        files.push_back(std::make_unique<MappedFile>(filepath));
+        std::string_view text = files.back()->view();
+        for (size_t pos = 0; pos < text.size();) {
+            size_t cut = findChunkEnd(text, pos, INGEST_CHUNK_SIZE);
+            tasks.push_back({files.size() - 1, pos, cut});
+            pos = cut;
+        }
+    }
+    num_threads = std::max<size_t>(1, std::min(num_threads, tasks.size()));
+
+    std::vector<HashTable> local_tables(num_threads);
+    runWorkStealing(tasks.size(), num_threads, [&](size_t worker, size_t index) {
+        const ChunkTask& task = tasks[index];
+        const MappedFile& file = *files[task.file];
+        HashTable& local = local_tables[worker];
+        forEachWord(file.view().substr(task.begin, task.end - task.begin), [&local](std::string_view word) {
+            NormalizedKey key(word);
+            std::string_view normalized = key.view();
+            local.findOrInsert(normalized, hashKey(normalized))++;
+        });
+        file.releaseRange(task.begin, task.end - task.begin);
+    });
+    if (num_threads == 1) {
+        return local_tables;
+    }
+
+    unsigned int partition_bits = 0;
+    while ((static_cast<size_t>(1) << partition_bits) < num_threads * 4) {
+        partition_bits++;
+    }
+    size_t num_partitions = static_cast<size_t>(1) << partition_bits;
+    std::vector<std::vector<std::vector<const HashNode*>>> per_partition(num_threads);
+    runParallel(num_threads, num_threads, [&](size_t worker) {
+        per_partition[worker].resize(num_partitions);
+        local_tables[worker].forEach([&](const HashNode& node) {
+            per_partition[worker][node.hash >> (sizeof(size_t) * 8 - partition_bits)].push_back(&node);
+        });
+    });
+
+    std::vector<HashTable> partitions(num_partitions);
+    runParallel(num_partitions, num_threads, [&](size_t p) {
+        size_t largest = 0;
+        for (size_t worker = 0; worker < num_threads; ++worker) {
+            largest = std::max(largest, per_partition[worker][p].size());
+        }
+        partitions[p].reserve(largest);
+        for (size_t worker = 0; worker < num_threads; ++worker) {
+            for (const HashNode* node : per_partition[worker][p]) {
+                partitions[p].findOrInsert(node->key, node->hash) += node->value;
+            }
+        }
+    });
+    return partitions;
+}
+
+template<typename TableType = HashTable>
+class Dictionary {
+private:
+    TableType ht;
+
+    /*std::string toLowerASCII(std::string s) const {
+        std::transform(s.begin(), s.end(), s.begin(),
+                       [](unsigned char c){ return std::tolower(c); });
+        return s;
+    }*/
+
+    void countWords(std::string_view text) {
+        forEachWord(text, [this](std::string_view word) {
+            NormalizedKey key(word);
+            std::string_view normalized = key.view();
+            ht.findOrInsert(normalized, hashKey(normalized))++;
+        });
+    }
+
+    // Оценка числа различных слов файла по его первому блоку: HyperLogLog по блоку и экстраполяция
+    // по закону Хипса с показателем 1/2 (словарь растет примерно как корень из объема текста).
+    static size_t estimateDistinctWords(std::string_view sample, size_t file_size) {
+        HyperLogLog distinct_counter;
+        forEachWord(sample, [&distinct_counter](std::string_view word) {
+            NormalizedKey key(word);
+            distinct_counter.addHash(hashKey(key.view()));
+        });
+        size_t in_sample = distinct_counter.estimate();
+        if (sample.empty() || file_size <= sample.size()) {
+            return in_sample + in_sample / 32; // небольшой запас на погрешность оценки
+        }
+        return static_cast<size_t>(in_sample * std::sqrt(static_cast<double>(file_size) / sample.size()));
+    }
+
+public:
+    Dictionary(size_t initial_capacity = 101) : ht(initial_capacity) {}
+
+    void addWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        //std::string word = toLowerASCII(word_raw);
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+
+        ht.findOrInsert(word, hashKey(word))++;
+    }
+
+    void removeWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        //std::string word = toLowerASCII(word_raw);
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+        ht.remove(word);
+    }
+
+    bool findWord(std::string_view word_raw) const {
+        if (word_raw.empty()) return false;
+        //std::string word = toLowerASCII(word_raw);
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+
+        const int* count_ptr = ht.get(word);
+        if (count_ptr) {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') найдено, частота: " << *count_ptr << std::endl;
+            return true;
+        } else {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') не найдено." << std::endl;
+            return false;
+        }
+    }
+
+    void clear() {
+        ht.clear();
+        std::cout << "Словарь (хеш-таблица) очищен." << std::endl;
+    }
+
+    void reserve(size_t expected_words) {
+        ht.reserve(expected_words);
+    }
+
+    void shrinkToFit() {
+        ht.shrink_to_fit();
+    }
+
+    // Потоковое построение за один проход, расход памяти не зависит от размера файла. Таблица заранее
+    // получает размер под ожидаемое число различных слов: подсказку expected_distinct_words или оценку
+    // по первому блоку, так что подсчет начинается сразу. Недобор оценки покрывает инкрементальный rehash.
+    void loadFromFile(const std::string& filepath, bool append = false, size_t expected_distinct_words = 0) {
+        if (!append) {
+            clear();
+        }
+        try {
+            size_t file_size = fileSizeBytes(filepath);
+            bool sized = false;
+            forEachTextChunkInFile(filepath, [&](std::string_view chunk) {
+                if (!sized) {
+                    sized = true;
+                    size_t expected = expected_distinct_words != 0 ? expected_distinct_words : estimateDistinctWords(chunk, file_size);
+                    ht.reserve(ht.size() + expected);
+                }
+                countWords(chunk);
+            });
+            std::cout << "Словарь загружен/дополнен из файла '" << filepath << "' (хеш-таблица)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файла (хеш-таблица): " << e.what() << std::endl;
+        }
+    }
+
+    // Загрузка набора файлов на num_threads потоках (0 - по числу ядер): частоты считает
+    // countWordsInFilesParallel, затем каждое различное слово один раз вливается в таблицу.
+    void loadFromFiles(const std::vector<std::string>& filepaths, bool append = false, size_t num_threads = 0) {
+        if (!append) {
+            clear();
+        }
+        try {
+            std::vector<HashTable> counts = countWordsInFilesParallel(filepaths, num_threads);
+            size_t distinct_words = 0;
+            for (const HashTable& part : counts) {
+                distinct_words += part.size();
+            }
+            ht.reserve(ht.size() + distinct_words);
+            for (const HashTable& part : counts) {
+                part.forEach([this](const HashNode& node) { ht.findOrInsert(node.key, node.hash) += node.value; });
+            }
+            std::cout << "Словарь загружен/дополнен из " << filepaths.size() << " файлов (хеш-таблица, параллельно)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файлов (хеш-таблица): " << e.what() << std::endl;
+        }
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        ht.print(os);
+    }
+
+    void visualizeStructure(std::ostream& os = std::cout) const {
+        ht.visualize(os);
+    }
+};
+
+// Словарь для многопоточного подсчета: ключи распределены по шардам по старшим битам хеша,
+// каждый шард - отдельная HashTable под собственным мьютексом.
+class ConcurrentDictionary {
+private:
+    static constexpr size_t PARALLEL_CHUNK_SIZE = 16 * STREAM_CHUNK_SIZE;
+
+    struct Shard {
+        std::mutex mutex;
+        HashTable table;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    unsigned int shard_bits;
+
+    size_t shardIndex(size_t hash) const {
+        // младшие биты хеша выбирают корзину внутри HashTable, поэтому шард берется по старшим
+        return shard_bits == 0 ? 0 : hash >> (sizeof(size_t) * 8 - shard_bits);
+    }
+
+    void addCount(std::string_view word, size_t hash, int count) {
+        Shard& shard = *shards[shardIndex(hash)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.table.findOrInsert(word, hash) += count;
+    }
+
+    // Подсчет диапазона слов в локальной таблице потока и слияние в шарды:
+    // каждый шард блокируется один раз на поток, а не на каждое слово.
+    template<typename WordContainer>
+    void countRange(const WordContainer& words, size_t begin, size_t end) {
+        HashTable local;
+        for (size_t i = begin; i < end; ++i) {
+            if (words[i].empty()) continue;
+            NormalizedKey key(words[i]);
+            std::string_view word = key.view();
+            local.findOrInsert(word, hashKey(word))++;
+        }
+
+        std::vector<std::vector<const HashNode*>> per_shard(shards.size());
+        local.forEach([&](const HashNode& node) {
+            per_shard[shardIndex(node.hash)].push_back(&node);
+        });
+        for (size_t s = 0; s < shards.size(); ++s) {
+            if (per_shard[s].empty()) continue;
+            std::lock_guard<std::mutex> lock(shards[s]->mutex);
+            for (const HashNode* node : per_shard[s]) {
+                shards[s]->table.findOrInsert(node->key, node->hash) += node->value;
+            }
+        }
+    }
+
+public:
+    explicit ConcurrentDictionary(size_t num_shards = 64) : shard_bits(0) {
+        while ((static_cast<size_t>(1) << shard_bits) < num_shards) {
+            shard_bits++;
+        }
+        shards.reserve(static_cast<size_t>(1) << shard_bits);
+        for (size_t i = 0; i < (static_cast<size_t>(1) << shard_bits); ++i) {
+            shards.push_back(std::make_unique<Shard>());
+        }
+    }
+
+    void addWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+        addCount(word, hashKey(word), 1);
+    }
+
+    void removeWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+        Shard& shard = *shards[shardIndex(hashKey(word))];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.table.remove(word);
+    }
+
+    bool findWord(std::string_view word_raw) const {
+        if (word_raw.empty()) return false;
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+        size_t hash = hashKey(word);
+
+        Shard& shard = *shards[shardIndex(hash)];
+        int count = 0;
+        bool found = false;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            const HashTable& table = shard.table;
+            if (const int* count_ptr = table.get(word, hash)) {
+                count = *count_ptr;
+                found = true;
+            }
+        }
+        if (found) {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') найдено, частота: " << count << std::endl;
+        } else {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') не найдено." << std::endl;
+        }
+        return found;
+    }
+
+    void clear() {
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->table.clear();
+        }
+        std::cout << "Словарь (шардированная хеш-таблица) очищен." << std::endl;
+    }
+
+    // Считает слова на num_threads потоках (0 - по числу ядер); поток слов делится на равные диапазоны.
+    template<typename WordContainer>
+    void countWords(const WordContainer& words, size_t num_threads = 0) {
+        if (num_threads == 0) num_threads = defaultThreadCount();
+        const size_t MIN_WORDS_PER_TASK = 4096;
+        size_t num_tasks = std::max<size_t>(1, std::min(num_threads * 4, words.size() / MIN_WORDS_PER_TASK));
+        size_t per_task = (words.size() + num_tasks - 1) / num_tasks;
+        runParallel(num_tasks, num_threads, [&](size_t task) {
+            size_t begin = task * per_task;
+            size_t end = std::min(words.size(), begin + per_task);
+            if (begin < end) countRange(words, begin, end);
+        });
+    }
+
+    void loadFromFile(const std::string& filepath, bool append = false, size_t num_threads = 0) {
+        if (!append) {
+            clear();
+        }
+        try {
+            // блоки крупнее обычного: каждый блок делится между потоками
+            forEachTextChunkInFile(filepath, [this, num_threads](std::string_view chunk) {
+                countWords(splitTextToWordViews(chunk), num_threads);
+            }, PARALLEL_CHUNK_SIZE);
+            std::cout << "Словарь загружен/дополнен из файла '" << filepath << "' (шардированная хеш-таблица)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файла (шардированная хеш-таблица): " << e.what() << std::endl;
+        }
+    }
+
+    // Разделы countWordsInFilesParallel выбираются по тем же старшим битам хеша, что и шарды,
+    // поэтому параллельное вливание разделов почти не конкурирует за мьютексы.
+    void loadFromFiles(const std::vector<std::string>& filepaths, bool append = false, size_t num_threads = 0) {
+        if (!append) {
+            clear();
+        }
+        try {
+            if (num_threads == 0) num_threads = defaultThreadCount();
+            std::vector<HashTable> counts = countWordsInFilesParallel(filepaths, num_threads);
+            runParallel(counts.size(), num_threads, [this, &counts](size_t p) {
+                counts[p].forEach([this](const HashNode& node) { addCount(node.key, node.hash, node.value); });
+            });
+            std::cout << "Словарь загружен/дополнен из " << filepaths.size() << " файлов (шардированная хеш-таблица, параллельно)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файлов (шардированная хеш-таблица): " << e.what() << std::endl;
+        }
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            total += shard->table.size();
+        }
+        return total;
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        os << "{";
+        bool first_item = true;
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->table.forEach([&](const HashNode& node) {
+                if (!first_item) {
+                    os << ", ";
+                }
+                os << "'" << node.key << "': " << node.value;
+                first_item = false;
+            });
+        }
+        os << "}";
+    }
+
+    void visualizeStructure(std::ostream& os = std::cout) const {
+        os << "Визуализация шардированной Хеш-таблицы (шардов: " << shards.size() << "):" << std::endl;
+        for (size_t i = 0; i < shards.size(); ++i) {
+            std::lock_guard<std::mutex> lock(shards[i]->mutex);
+            os << "Шард [" << i << "]: " << shards[i]->table.size() << " эл." << std::endl;
+        }
+    }
+};
+
+// Освобождение памяти по эпохам: объект, снятый с публикации, удаляется только после того,
+// как все читатели, которые могли его видеть, завершили чтение.
+// Собственный слот получают до MAX_READERS одновременных читателей; остальные не ждут, а учитываются
+// общим счетчиком, и пока такие читатели есть, освобождение снятых объектов откладывается.
+template<typename T>
+class EpochReclaimer {
+public:
+    static constexpr size_t MAX_READERS = 128;
+
+private:
+    static constexpr size_t OVERFLOW_SLOT = MAX_READERS;
+    static constexpr uint64_t INACTIVE = 0;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<bool> in_use{false};
+        std::atomic<uint64_t> epoch{INACTIVE};
+    };
+
+    std::atomic<uint64_t> global_epoch{1};
+    ReaderSlot readers[MAX_READERS];
+    std::atomic<size_t> overflow_readers{0}; // читатели без слота: их эпоха неизвестна
+    std::mutex retire_mutex; // только для писателей
+    std::vector<std::pair<uint64_t, std::unique_ptr<T>>> retired;
+
+    uint64_t minActiveEpoch() const {
+        if (overflow_readers.load() != 0) {
+            return INACTIVE; // ничего не освобождаем
+        }
+        uint64_t min_epoch = UINT64_MAX;
+        for (const auto& reader : readers) {
+            uint64_t epoch = reader.epoch.load();
+            if (epoch != INACTIVE) {
+                min_epoch = std::min(min_epoch, epoch);
+            }
+        }
+        return min_epoch;
+    }
+
+public:
+    class ReadGuard {
+    private:
+        EpochReclaimer& owner;
+        size_t slot;
+
+    public:
+        explicit ReadGuard(EpochReclaimer& r) : owner(r), slot(r.enter()) {}
+        ~ReadGuard() { owner.exit(slot); }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    size_t enter() {
+        static thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+        for (size_t i = 0; i < MAX_READERS; ++i) {
+            size_t slot = (hint + i) % MAX_READERS;
+            bool expected = false;
+            if (!readers[slot].in_use.load(std::memory_order_relaxed)
+                && readers[slot].in_use.compare_exchange_strong(expected, true)) {
+                readers[slot].epoch.store(global_epoch.load());
+                hint = slot;
+                return slot;
+            }
+        }
+        overflow_readers.fetch_add(1);
+        return OVERFLOW_SLOT;
+    }
+
+    void exit(size_t slot) {
+        if (slot == OVERFLOW_SLOT) {
+            overflow_readers.fetch_sub(1);
+            return;
+        }
+        readers[slot].epoch.store(INACTIVE);
+        readers[slot].in_use.store(false, std::memory_order_release);
+    }
+
+    // Вызывается писателем после того, как объект перестал быть доступен через опубликованный указатель.
+    void retire(std::unique_ptr<T> object) {
+        std::lock_guard<std::mutex> lock(retire_mutex);
+        uint64_t retire_epoch = global_epoch.fetch_add(1);
+        retired.emplace_back(retire_epoch, std::move(object));
+
+        uint64_t min_epoch = minActiveEpoch();
+        retired.erase(std::remove_if(retired.begin(), retired.end(),
+                                     [min_epoch](const auto& entry) { return entry.first < min_epoch; }),
+                      retired.end());
+    }
+
+    size_t pendingCount() {
+        std::lock_guard<std::mutex> lock(retire_mutex);
+        return retired.size();
+    }
+};
+
+// Словарь со снимками (RCU): читатели работают с опубликованным неизменяемым снимком без блокировок,
+// новый снимок строится в фоне и публикуется атомарной заменой указателя.
+// Снимок разбит на шарды (HashTable) по старшим битам хеша; шарды, которых правка не коснулась,
+// новый снимок делит с прежним, поэтому запись копирует только массив указателей и один шард.
+class SnapshotDictionary {
+private:
+    using Shard = std::shared_ptr<const HashTable>;
+
+    struct Snapshot {
+        unsigned shard_bits = 0;
+        std::vector<Shard> shards = std::vector<Shard>(1); // nullptr - пустой шард
+        size_t total = 0;
+
+        size_t shardIndex(size_t hash) const {
+            return shard_bits == 0 ? 0 : hash >> (sizeof(size_t) * 8 - shard_bits);
+        }
+    };
+
+    // Слов в шарде после перестроения; при вдвое большем среднем снимок перестраивается на вдвое больше шардов.
+    static constexpr size_t TARGET_SHARD_SIZE = 4096;
+
+    std::atomic<Snapshot*> current;
+    mutable EpochReclaimer<Snapshot> reclaimer;
+    std::mutex writer_mutex;
+    std::thread reload_thread;
+
+    static std::unique_ptr<HashTable> cloneTable(const HashTable& source) {
+        auto copy = std::make_unique<HashTable>();
+        copy->reserve(source.size());
+        source.forEach([&copy](const HashNode& node) {
+            copy->findOrInsert(node.key, node.hash) = node.value;
+        });
+        return copy;
+    }
+
+    static unsigned shardBitsFor(size_t elements) {
+        unsigned bits = 0;
+        while ((elements >> bits) > TARGET_SHARD_SIZE) {
+            bits++;
+        }
+        return bits;
+    }
+
+    static void setShard(Snapshot& snapshot, size_t index, std::unique_ptr<HashTable> table) {
+        const Shard& previous = snapshot.shards[index];
+        snapshot.total -= previous ? previous->size() : 0;
+        snapshot.total += table->size();
+        if (table->size() == 0) {
+            snapshot.shards[index].reset();
+        } else {
+            table->shrink_to_fit(); // завершает незаконченный инкрементальный rehash: дальше шард только читается
+            snapshot.shards[index] = std::move(table);
+        }
+    }
+
+    // Полное перестроение: частоты одинаковых слов из всех источников складываются.
+    static std::unique_ptr<Snapshot> buildSnapshot(const std::vector<const HashTable*>& sources) {
+        size_t expected = 0;
+        for (const HashTable* source : sources) {
+            expected += source->size();
+        }
+        auto next = std::make_unique<Snapshot>();
+        next->shard_bits = shardBitsFor(expected);
+        std::vector<std::unique_ptr<HashTable>> tables(size_t(1) << next->shard_bits);
+        for (const HashTable* source : sources) {
+            source->forEach([&](const HashNode& node) {
+                auto& table = tables[next->shardIndex(node.hash)];
+                if (!table) {
+                    table = std::make_unique<HashTable>();
+                }
+                table->findOrInsert(node.key, node.hash) += node.value;
+            });
+        }
+        next->shards.assign(tables.size(), nullptr);
+        for (size_t i = 0; i < tables.size(); ++i) {
+            if (tables[i]) {
+                setShard(*next, i, std::move(tables[i]));
+            }
+        }
+        return next;
+    }
+
+    static std::vector<const HashTable*> shardsOf(const Snapshot& snapshot) {
+        std::vector<const HashTable*> tables;
+        for (const Shard& shard : snapshot.shards) {
+            if (shard) tables.push_back(shard.get());
+        }
+        return tables;
+    }
+
+    // Накладывает delta на снимок: копируются только затронутые шарды. Если шарды переполнятся,
+    // снимок перестраивается целиком (амортизированно O(1) на слово - число шардов при этом удваивается).
+    static std::unique_ptr<Snapshot> mergeInto(const Snapshot& base, const HashTable& delta) {
+        if (shardBitsFor(base.total + delta.size()) > base.shard_bits + 1) {
+            std::vector<const HashTable*> sources = shardsOf(base);
+            sources.push_back(&delta);
+            return buildSnapshot(sources);
+        }
+        auto next = std::make_unique<Snapshot>(base);
+        std::vector<std::unique_ptr<HashTable>> touched(next->shards.size());
+        delta.forEach([&](const HashNode& node) {
+            size_t index = next->shardIndex(node.hash);
+            auto& table = touched[index];
+            if (!table) {
+                table = base.shards[index] ? cloneTable(*base.shards[index]) : std::make_unique<HashTable>();
+            }
+            table->findOrInsert(node.key, node.hash) += node.value;
+        });
+        for (size_t i = 0; i < touched.size(); ++i) {
+            if (touched[i]) {
+                setShard(*next, i, std::move(touched[i]));
+            }
+        }
+        return next;
+    }
+
+    // вызывается под writer_mutex
+    void publish(std::unique_ptr<Snapshot> snapshot) {
+        Snapshot* old_snapshot = current.exchange(snapshot.release());
+        reclaimer.retire(std::unique_ptr<Snapshot>(old_snapshot));
+    }
+
+    // Правка одного слова: копия его шарда, изменение, публикация. O(число шардов + размер шарда).
+    template<typename Mutation>
+    void updateShard(size_t hash, Mutation mutate) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        const Snapshot& base = *current.load();
+        if (shardBitsFor(base.total + 1) > base.shard_bits + 1) {
+            publish(buildSnapshot(shardsOf(base)));
+        }
+        auto next = std::make_unique<Snapshot>(*current.load());
+        size_t index = next->shardIndex(hash);
+        const Shard& source = next->shards[index];
+        std::unique_ptr<HashTable> table = source ? cloneTable(*source) : std::make_unique<HashTable>();
+        mutate(*table);
+        setShard(*next, index, std::move(table));
+        publish(std::move(next));
+    }
+
+    // Файл разбирается без блокировки в отдельную таблицу; при дополнении она накладывается
+    // на текущий снимок уже под writer_mutex, чтобы не потерять правки, сделанные во время разбора.
+    void buildFromFile(const std::string& filepath, bool append) {
+        auto delta = std::make_unique<HashTable>();
+        forEachWordInFile(filepath, [&delta](std::string_view word) {
+            NormalizedKey key(word);
+            std::string_view normalized = key.view();
+            delta->findOrInsert(normalized, hashKey(normalized))++;
+        });
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        publish(append ? mergeInto(*current.load(), *delta) : buildSnapshot({delta.get()}));
+    }
+
+public:
+    SnapshotDictionary() : current(new Snapshot()) {}
+
+    ~SnapshotDictionary() {
+        waitForReload();
+        delete current.load();
+    }
+
+    SnapshotDictionary(const SnapshotDictionary&) = delete;
+    SnapshotDictionary& operator=(const SnapshotDictionary&) = delete;
+
+    void addWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+        size_t hash = hashKey(word);
+        updateShard(hash, [word, hash](HashTable& table) { table.findOrInsert(word, hash)++; });
+    }
+
+    void removeWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+        if (lookup(word) == 0) return; // снимок не меняется - копировать шард незачем
+        updateShard(hashKey(word), [word](HashTable& table) { table.remove(word); });
+    }
+
+    // Поиск без ожидания (wait-free): вход в эпоху - не больше MAX_READERS попыток CAS и один fetch_add,
+    // дальше чтение шарда текущего снимка без повторов.
+    int lookup(std::string_view normalized_word) const {
+        EpochReclaimer<Snapshot>::ReadGuard guard(reclaimer);
+        size_t hash = hashKey(normalized_word);
+        const Snapshot* snapshot = current.load();
+        const HashTable* shard = snapshot->shards[snapshot->shardIndex(hash)].get();
+        const int* count_ptr = shard ? shard->get(normalized_word, hash) : nullptr;
+        return count_ptr ? *count_ptr : 0;
+    }
+
+    int frequency(std::string_view word_raw) const {
+        NormalizedKey key(word_raw);
+        return lookup(key.view());
+    }
+
+    bool findWord(std::string_view word_raw) const {
+        if (word_raw.empty()) return false;
+        NormalizedKey key(word_raw);
+        int count = lookup(key.view());
+        if (count > 0) {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << key.view() << "') найдено, частота: " << count << std::endl;
+            return true;
+        } else {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << key.view() << "') не найдено." << std::endl;
+            return false;
+        }
+    }
+
+    void clear() {
+        waitForReload();
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        publish(std::make_unique<Snapshot>());
+        std::cout << "Словарь (снимки хеш-таблицы) очищен." << std::endl;
+    }
+
+    // Строит новый снимок в фоновом потоке; до публикации читатели видят прежний.
+    void reloadAsync(const std::string& filepath, bool append = false) {
+        waitForReload();
+        reload_thread = std::thread([this, filepath, append]() {
+            try {
+                buildFromFile(filepath, append);
+                std::cout << "Словарь загружен/дополнен из файла '" << filepath << "' (снимки хеш-таблицы)." << std::endl;
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Ошибка при загрузке из файла (снимки хеш-таблицы): " << e.what() << std::endl;
+            }
+        });
+    }
+
+    void waitForReload() {
+        if (reload_thread.joinable()) {
+            reload_thread.join();
+        }
+    }
+
+    void loadFromFile(const std::string& filepath, bool append = false) {
+        reloadAsync(filepath, append);
+        waitForReload();
+    }
+
+    void loadFromFiles(const std::vector<std::string>& filepaths, bool append = false, size_t num_threads = 0) {
+        waitForReload();
+        try {
+            std::vector<HashTable> counts = countWordsInFilesParallel(filepaths, num_threads);
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            std::vector<const HashTable*> sources = append ? shardsOf(*current.load()) : std::vector<const HashTable*>();
+            for (const HashTable& part : counts) {
+                sources.push_back(&part);
+            }
+            publish(buildSnapshot(sources));
+            std::cout << "Словарь загружен/дополнен из " << filepaths.size() << " файлов (снимки хеш-таблицы, параллельно)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файлов (снимки хеш-таблицы): " << e.what() << std::endl;
+        }
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        EpochReclaimer<Snapshot>::ReadGuard guard(reclaimer);
+        os << "{";
+        bool first_item = true;
+        for (const Shard& shard : current.load()->shards) {
+            if (!shard) continue;
+            shard->forEach([&](const HashNode& node) {
+                if (!first_item) {
+                    os << ", ";
+                }
+                os << "'" << node.key << "': " << node.value;
+                first_item = false;
+            });
+        }
+        os << "}";
+    }
+
+    void visualizeStructure(std::ostream& os = std::cout) const {
+        EpochReclaimer<Snapshot>::ReadGuard guard(reclaimer);
+        const Snapshot* snapshot = current.load();
+        os << "Снимков ожидает освобождения: " << reclaimer.pendingCount() << std::endl;
+        os << "Шардов: " << snapshot->shards.size() << ", слов: " << snapshot->total << std::endl;
+        for (size_t i = 0; i < snapshot->shards.size(); ++i) {
+            if (!snapshot->shards[i]) continue;
+            os << "Шард [" << i << "]: ";
+            snapshot->shards[i]->visualize(os);
+        }
+    }
+};
+
+}
+
+namespace DictionaryWithRBTree {
+
+enum Color { RED, BLACK };
+
+struct Node {
+    std::string_view key; // байты ключа лежат в StringArena дерева
+    int value;
+    Color color;
+    Node *parent, *left, *right;
+    size_t size;   // число узлов в поддереве
+    long long sum; // сумма частот в поддереве
+
+    Node(std::string_view k, int v, Color c = RED, Node* p = nullptr, Node* l = nullptr, Node* r = nullptr)
+        : key(k), value(v), color(c), parent(p), left(l), right(r), size(1), sum(v) {}
+};
+
+// Пул узлов: узлы выделяются подряд блоками (slab) по NODES_PER_SLAB штук,
+// освобожденные узлы переиспользуются через список свободных, releaseAll() отдает все блоки сразу.
+class NodePool {
+private:
+    static constexpr size_t NODES_PER_SLAB = 4096;
+    using NodeStorage = typename std::aligned_storage<sizeof(Node), alignof(Node)>::type;
+
+    std::vector<std::unique_ptr<NodeStorage[]>> slabs;
+    size_t used_in_last_slab;
+    Node* free_list; // связан через поле right
+    size_t live_nodes;
+    size_t reserved_bytes; // с учетом заголовков выделений (heapAllocationSize)
+
+    static_assert(std::is_trivially_destructible<Node>::value, "NodePool освобождает узлы без вызова деструкторов");
+
+public:
+    NodePool() : used_in_last_slab(NODES_PER_SLAB), free_list(nullptr), live_nodes(0), reserved_bytes(0) {}
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    template<typename... Args>
+    Node* allocate(Args&&... args) {
+        void* memory;
+        if (free_list != nullptr) {
+            memory = free_list;
+            free_list = free_list->right;
+        } else {
+            if (used_in_last_slab == NODES_PER_SLAB) {
+                slabs.push_back(std::make_unique<NodeStorage[]>(NODES_PER_SLAB));
+                used_in_last_slab = 0;
+                reserved_bytes += heapAllocationSize(NODES_PER_SLAB * sizeof(NodeStorage));
+            }
+            memory = &slabs.back()[used_in_last_slab++];
+        }
+        live_nodes++;
+        return new (memory) Node(std::forward<Args>(args)...);
+    }
+
+    // Один непрерывный блок под count узлов (для пакетного построения); узлы в нем конструирует вызывающий.
+    Node* allocateBlock(size_t count) {
+        slabs.push_back(std::make_unique<NodeStorage[]>(count));
+        used_in_last_slab = NODES_PER_SLAB; // в этот блок обычные allocate() не попадают
+        live_nodes += count;
+        reserved_bytes += heapAllocationSize(count * sizeof(NodeStorage));
+        return reinterpret_cast<Node*>(slabs.back().get());
+    }
+
+    void deallocate(Node* node) {
+        node->right = free_list;
+        free_list = node;
+        live_nodes--;
+    }
+
+    void releaseAll() {
+        slabs.clear();
+        slabs.shrink_to_fit();
+        used_in_last_slab = NODES_PER_SLAB;
+        free_list = nullptr;
+        live_nodes = 0;
+        reserved_bytes = 0;
+    }
+
+    size_t slabCount() const {
+        return slabs.size();
+    }
+
+    size_t liveNodes() const {
+        return live_nodes;
+    }
+
+    size_t bytesReserved() const {
+        return reserved_bytes;
+    }
+};
+
+class RBTree {
+private:
+    Node* root;
+    Node* NIL;
+    Node* rightmost; // наибольший ключ: подсказка для вставки монотонно растущих ключей
+    StringArena key_arena;
+    NodePool node_pool;
+
+    void updateAugmentation(Node* node) {
+        node->size = node->left->size + node->right->size + 1;
+        node->sum = node->left->sum + node->right->sum + node->value;
+    }
+
+    void updateAugmentationUpward(Node* node) {
+        while (node != NIL) {
+            updateAugmentation(node);
+            node = node->parent;
+        }
+    }
+
+    void leftRotate(Node* x) {
         Node* y = x->right;
         x->right = y->left;
         if (y->left != NIL) {
             y->left->parent = x;
         }
-        y->parent = x->parent;
-        if (x->parent == NIL) {
-            root = y;
-        } else if (x == x->parent->left) {
-            x->parent->left = y;
+        y->parent = x->parent;
+        if (x->parent == NIL) {
+            root = y;
+        } else if (x == x->parent->left) {
+            x->parent->left = y;
+        } else {
+            x->parent->right = y;
+        }
+        y->left = x;
+        x->parent = y;
+        y->size = x->size;
+        y->sum = x->sum;
+        updateAugmentation(x);
+    }
+
+    void rightRotate(Node* y) {
+        Node* x = y->left;
+        y->left = x->right;
+        if (x->right != NIL) {
+            x->right->parent = y;
+        }
+        x->parent = y->parent;
+        if (y->parent == NIL) {
+            root = x;
+        } else if (y == y->parent->right) {
+            y->parent->right = x;
+        } else {
+            y->parent->left = x;
+        }
+        x->right = y;
+        y->parent = x;
+        x->size = y->size;
+        x->sum = y->sum;
+        updateAugmentation(y);
+    }
+
+    void insertFixup(Node* z) {
+        while (z->parent->color == RED) {
+            if (z->parent == z->parent->parent->left) {
+                Node* y = z->parent->parent->right;
+                if (y->color == RED) {
+                    z->parent->color = BLACK;
+                    y->color = BLACK;
+                    z->parent->parent->color = RED;
+                    z = z->parent->parent;
+                } else {
+                    if (z == z->parent->right) {
+                        z = z->parent;
+                        leftRotate(z);
+                    }
+                    z->parent->color = BLACK;
+                    z->parent->parent->color = RED;
+                    rightRotate(z->parent->parent);
+                }
+            } else {
+                Node* y = z->parent->parent->left;
+                if (y->color == RED) {
+                    z->parent->color = BLACK;
+                    y->color = BLACK;
+                    z->parent->parent->color = RED;
+                    z = z->parent->parent;
+                } else {
+                    if (z == z->parent->left) {
+                        z = z->parent;
+                        rightRotate(z);
+                    }
+                    z->parent->color = BLACK;
+                    z->parent->parent->color = RED;
+                    leftRotate(z->parent->parent);
+                }
+            }
+             if (z == root) break; // Оптимизация: если z дошел до корня
+        }
+        root->color = BLACK;
+    }
+
+    Node* findNode(std::string_view key) const {
+        Node* current = root;
+        while (current != NIL && current->key != key) {
+            if (key < current->key) {
+                current = current->left;
+            } else {
+                current = current->right;
+            }
+        }
+        return current;
+    }
+
+    void transplant(Node* u, Node* v) {
+        if (u->parent == NIL) {
+            root = v;
+        } else if (u == u->parent->left) {
+            u->parent->left = v;
+        } else {
+            u->parent->right = v;
+        }
+        v->parent = u->parent;
+    }
+
+    Node* minimum(Node* node) {
+        while (node->left != NIL) {
+            node = node->left;
+        }
+        return node;
+    }
+
+    Node* maximum(Node* node) {
+        while (node->right != NIL) {
+            node = node->right;
+        }
+        return node;
+    }
+
+    // Изменение значения узла: размеры поддеревьев не меняются, суммы на пути к корню сдвигаются на delta.
+    void addToPathSums(Node* node, int delta) {
+        for (; node != NIL; node = node->parent) {
+            node->sum += delta;
+        }
+    }
+
+    // Создает узел на месте, найденном спуском (parent == NIL - пустое дерево), и восстанавливает свойства.
+    Node* attachNewNode(Node* parent, bool as_left, std::string_view key, int value) {
+        Node* z = node_pool.allocate(key_arena.intern(key), value, RED, parent, NIL, NIL);
+        if (parent == NIL) {
+            root = z;
+        } else if (as_left) {
+            parent->left = z;
+        } else {
+            parent->right = z;
+        }
+        if (rightmost == NIL || (parent == rightmost && !as_left)) {
+            rightmost = z;
+        }
+        for (Node* node = parent; node != NIL; node = node->parent) {
+            node->size++;
+            node->sum += value;
+        }
+        insertFixup(z);
+        return z;
+    }
+
+    void deleteFixup(Node* x) {
+        while (x != root && x->color == BLACK) { // x "несет" дополнительный черный цвет
+            if (x == x->parent->left) { // x - левый ребенок
+                Node* w = x->parent->right; // w - брат x
+                // случай 1: Брат w красный
+                if (w->color == RED) {
+                    w->color = BLACK;
+                    x->parent->color = RED;
+                    leftRotate(x->parent);
+                    w = x->parent->right; // новый брат w (теперь он гарантированно черный)
+                }
+                // теперь w точно черный
+                // случай 2: брат w черный, и оба его ребенка черные
+                if (w->left->color == BLACK && w->right->color == BLACK) {
+                    w->color = RED; // "отдаем" черный цвет w родителю
+                    x = x->parent;  // перемещаем проблему (доп. черный) вверх к родителю
+                } else {
+                    // случай 3: брат w черный, левый ребенок w красный, правый черный
+                    if (w->right->color == BLACK) { // (значит, w->left->color == RED)
+                        w->left->color = BLACK;
+                        w->color = RED;
+                        rightRotate(w);
+                        w = x->parent->right; // новый брат w (для случая 4)
+                    }
+                    // случай 4: брат w черный, и его правый ребенок красный
+                    // (w->left->color может быть любым)
+                    w->color = x->parent->color; // w наследует цвет родителя
+                    x->parent->color = BLACK;    // родитель становится черным
+                    w->right->color = BLACK;     // правый ребенок w становится черным
+                    leftRotate(x->parent);
+                    x = root; // проблема решена, завершаем цикл
+                }
+            } else { // x - правый ребенок (симметричные случаи)
+                Node* w = x->parent->left; // w - брат x
+                // случай 1 (симметричный)
+                if (w->color == RED) {
+                    w->color = BLACK;
+                    x->parent->color = RED;
+                    rightRotate(x->parent);
+                    w = x->parent->left;
+                }
+                // случай 2 (симметричный)
+                if (w->right->color == BLACK && w->left->color == BLACK) {
+                    w->color = RED;
+                    x = x->parent;
+                } else {
+                    // случай 3 (симметричный): брат w черный, правый ребенок w красный, левый черный
+                    if (w->left->color == BLACK) { // (значит, w->right->color == RED)
+                        w->right->color = BLACK;
+                        w->color = RED;
+                        leftRotate(w);
+                        w = x->parent->left;
+                    }
+                    // случай 4 (симметричный)
+                    w->color = x->parent->color;
+                    x->parent->color = BLACK;
+                    w->left->color = BLACK;
+                    rightRotate(x->parent);
+                    x = root;
+                }
+            }
+        }
+        x->color = BLACK; // убираем "дополнительный черный" с x (если x не NIL) или окрашиваем корень.
+    }
+
+    void inorderPrintRecursive(Node* node, std::ostream& os, bool& first_item) const {
+        if (node != NIL) {
+            inorderPrintRecursive(node->left, os, first_item);
+            if (!first_item) {
+                os << ", ";
+            }
+            os << "'" << node->key << "': " << node->value << " (" << (node->color == RED ? "R" : "B") << ")";
+            first_item = false;
+            inorderPrintRecursive(node->right, os, first_item);
+        }
+    }
+
+    bool printGivenLevel(Node* node, int level, std::ostream& os, bool first_on_level) const {
+        if (node == NIL) {
+            return false;
+        }
+        if (level == 1) {
+            if (!first_on_level) {
+                os << "  ";
+            }
+            os << "(\"" << node->key << "\":" << node->value << (node->color == RED ? " R" : " B") << ")";
+            return true;
+        } else if (level > 1) {
+            bool left_printed = printGivenLevel(node->left, level - 1, os, first_on_level);
+            bool right_printed = printGivenLevel(node->right, level - 1, os, first_on_level && !left_printed);
+            return left_printed || right_printed;
+        }
+        return false;
+    }
+
+    int getMaxDepth(Node* node) const {
+        if (node == NIL) return 0;
+        int left_depth = getMaxDepth(node->left);
+        int right_depth = getMaxDepth(node->right);
+        return std::max(left_depth, right_depth) + 1;
+    }
+
+    void printTreeRecursive(Node* node, int space_increment, int current_space, std::ostream& os) const {
+        if (node == NIL) {
+            return;
+        }
+
+        current_space += space_increment;
+
+        printTreeRecursive(node->right, space_increment, current_space, os);
+
+        os << std::endl;
+        for (int i = space_increment; i < current_space; i++) {
+            os << " ";
+        }
+        os << "(\"" << node->key << "\":" << node->value << (node->color == RED ? " R" : " B") << ")";
+
+        printTreeRecursive(node->left, space_increment, current_space, os);
+    }
+
+    // Наименьшая строка, большая всех строк с данным префиксом; false, если такой нет (префикс из 0xFF).
+    static bool prefixUpperBound(std::string_view prefix, std::string& upper) {
+        upper.assign(prefix.data(), prefix.size());
+        while (!upper.empty()) {
+            unsigned char last = static_cast<unsigned char>(upper.back());
+            if (last != 0xFF) {
+                upper.back() = static_cast<char>(last + 1);
+                return true;
+            }
+            upper.pop_back();
+        }
+        return false;
+    }
+
+    template<typename Visitor>
+    void forEachInOrderRecursive(Node* node, Visitor& visit) const {
+        if (node != NIL) {
+            forEachInOrderRecursive(node->left, visit);
+            visit(node->key, node->value);
+            forEachInOrderRecursive(node->right, visit);
+        }
+    }
+
+    // возвращает false, если посетитель попросил остановить обход
+    template<typename Visitor>
+    bool forEachWithPrefixRecursive(Node* node, std::string_view prefix, Visitor& visit) const {
+        if (node == NIL) return true;
+        int order = node->key.compare(0, prefix.size(), prefix);
+        if (order >= 0) { // ключ узла не меньше префикса: подходящие ключи могут быть слева
+            if (!forEachWithPrefixRecursive(node->left, prefix, visit)) return false;
+        }
+        if (order == 0) {
+            if (!visit(node->key, node->value)) return false;
+        }
+        if (order <= 0) {
+            return forEachWithPrefixRecursive(node->right, prefix, visit);
+        }
+        return true;
+    }
+
+    // Строит сбалансированное поддерево из nodes[lo, hi); красными становятся только узлы самого нижнего уровня.
+    Node* buildBalanced(Node* nodes, size_t lo, size_t hi, size_t depth, size_t red_depth, Node* parent) {
+        if (lo >= hi) return NIL;
+        size_t mid = lo + (hi - lo) / 2;
+        Node* node = &nodes[mid];
+        node->parent = parent;
+        node->color = (depth == red_depth) ? RED : BLACK;
+        node->left = buildBalanced(nodes, lo, mid, depth + 1, red_depth, node);
+        node->right = buildBalanced(nodes, mid + 1, hi, depth + 1, red_depth, node);
+        updateAugmentation(node);
+        return node;
+    }
+
+public:
+    RBTree() {
+        NIL = new Node("", 0, BLACK);
+        NIL->size = 0;
+        NIL->parent = NIL;
+        NIL->left = NIL;
+        NIL->right = NIL;
+        root = NIL;
+        rightmost = NIL;
+    }
+
+    explicit RBTree(const std::vector<std::pair<std::string_view, int>>& sorted_entries) : RBTree() {
+        assignSorted(sorted_entries);
+    }
+
+    ~RBTree() {
+        delete NIL;
+    }
+
+    RBTree(const RBTree&) = delete;
+    RBTree& operator=(const RBTree&) = delete;
+
+    // Один спуск с трехсторонним сравнением; узел выделяется из пула только при промахе.
+    void insert(std::string_view key, int value) {
+        Node* y = NIL;
+        Node* x = root;
+        int order = 0;
+
+        while (x != NIL) {
+            order = key.compare(x->key);
+            if (order == 0) {
+                int delta = value - x->value;
+                x->value = value;
+                addToPathSums(x, delta);
+                return;
+            }
+            y = x;
+            x = (order < 0) ? x->left : x->right;
+        }
+        attachNewNode(y, order < 0, key, value);
+    }
+
+    // Вставка с подсказкой для монотонно растущих ключей: ключ больше текущего максимума
+    // присоединяется справа от него за одно сравнение, без спуска от корня.
+    void insertHinted(std::string_view key, int value) {
+        if (rightmost != NIL && rightmost->key < key) {
+            attachNewNode(rightmost, false, key, value);
+            return;
+        }
+        insert(key, value);
+    }
+
+    // Счетчик за один спуск: при попадании значение и суммы меняются на месте,
+    // при промахе создается узел со значением delta. Возвращает новое значение.
+    int increment(std::string_view key, int delta = 1) {
+        Node* y = NIL;
+        Node* x = root;
+        int order = 0;
+
+        while (x != NIL) {
+            order = key.compare(x->key);
+            if (order == 0) {
+                x->value += delta;
+                addToPathSums(x, delta);
+                return x->value;
+            }
+            y = x;
+            x = (order < 0) ? x->left : x->right;
+        }
+        return attachNewNode(y, order < 0, key, delta)->value;
+    }
+
+    // Изменяет частоту существующего ключа с обновлением сумм на пути к корню.
+    bool adjustValue(std::string_view key, int delta) {
+        Node* node = findNode(key);
+        if (node == NIL) return false;
+        node->value += delta;
+        addToPathSums(node, delta);
+        return true;
+    }
+
+    // Значение только для чтения: прямое изменение нарушило бы суммы поддеревьев.
+    const int* search(std::string_view key) const {
+        Node* node = findNode(key);
+        return (node == NIL) ? nullptr : &node->value;
+    }
+
+    size_t size() const {
+        return root->size;
+    }
+
+    // Число ключей, строго меньших key, за O(log n).
+    size_t rank(std::string_view key) const {
+        size_t result = 0;
+        Node* current = root;
+        while (current != NIL) {
+            if (key <= current->key) {
+                current = current->left;
+            } else {
+                result += current->left->size + 1;
+                current = current->right;
+            }
+        }
+        return result;
+    }
+
+    // k-й по порядку ключ (с нуля) за O(log n); nullptr, если k >= size().
+    const Node* select(size_t k) const {
+        Node* current = root;
+        while (current != NIL) {
+            size_t left_size = current->left->size;
+            if (k < left_size) {
+                current = current->left;
+            } else if (k == left_size) {
+                return current;
+            } else {
+                k -= left_size + 1;
+                current = current->right;
+            }
+        }
+        return nullptr;
+    }
+
+    // Сумма частот ключей, строго меньших key, за O(log n).
+    long long prefixFrequency(std::string_view key) const {
+        long long result = 0;
+        Node* current = root;
+        while (current != NIL) {
+            if (key <= current->key) {
+                current = current->left;
+            } else {
+                result += current->left->sum + current->value;
+                current = current->right;
+            }
+        }
+        return result;
+    }
+
+    // Сумма частот ключей из полуинтервала [from, to).
+    long long rangeFrequency(std::string_view from, std::string_view to) const {
+        if (!(from < to)) return 0;
+        return prefixFrequency(to) - prefixFrequency(from);
+    }
+
+    // Обход ключей, начинающихся с prefix, по возрастанию: спуск O(log n) плюс O(k) на найденные ключи.
+    // visit(key, value) возвращает false, чтобы прекратить обход.
+    template<typename Visitor>
+    void forEachWithPrefix(std::string_view prefix, Visitor visit) const {
+        forEachWithPrefixRecursive(root, prefix, visit);
+    }
+
+    size_t countWithPrefix(std::string_view prefix) const {
+        std::string upper;
+        if (!prefixUpperBound(prefix, upper)) {
+            return size() - rank(prefix);
+        }
+        return rank(upper) - rank(prefix);
+    }
+
+    long long frequencyWithPrefix(std::string_view prefix) const {
+        std::string upper;
+        if (!prefixUpperBound(prefix, upper)) {
+            return root->sum - prefixFrequency(prefix);
+        }
+        return prefixFrequency(upper) - prefixFrequency(prefix);
+    }
+
+    bool remove(std::string_view key) {
+        Node* z = findNode(key);
+        if (z == NIL) return false;
+
+        Node* y = z;
+        Node* x;
+        Node* augmentation_start = z->parent; // самый нижний узел, у которого меняется поддерево
+        Color y_original_color = y->color;
+
+        if (z->left == NIL) {
+            x = z->right;
+            transplant(z, z->right);
+        } else if (z->right == NIL) {
+            x = z->left;
+            transplant(z, z->left);
+        } else {
+            y = minimum(z->right);
+            y_original_color = y->color;
+            x = y->right;
+            augmentation_start = (y->parent == z) ? y : y->parent;
+            if (y->parent == z) { // y - непосредственный потомок z
+                x->parent = y; // даже если x == NIL: deleteFixup поднимается от x по parent
+            } else {
+                transplant(y, y->right);
+                y->right = z->right;
+                y->right->parent = y;
+            }
+            transplant(z, y);
+            y->left = z->left;
+            y->left->parent = y;
+            y->color = z->color;
+        }
+        updateAugmentationUpward(augmentation_start);
+        node_pool.deallocate(z);
+
+        if (y_original_color == BLACK) {
+            deleteFixup(x);
+        }
+        if (z == rightmost) {
+            rightmost = (root == NIL) ? NIL : maximum(root);
+        }
+        return true;
+    }
+
+    // Пакетное построение за O(n) из строго возрастающей последовательности ключей:
+    // все узлы размещаются одним блоком, дерево строится сразу сбалансированным, без insertFixup.
+    void assignSorted(const std::vector<std::pair<std::string_view, int>>& sorted_entries) {
+        for (size_t i = 1; i < sorted_entries.size(); ++i) {
+            if (!(sorted_entries[i - 1].first < sorted_entries[i].first)) {
+                throw std::runtime_error("Пакетное построение: ключи не упорядочены или повторяются (позиция "
+                                         + std::to_string(i) + ").");
+            }
+        }
+        clear();
+        size_t n = sorted_entries.size();
+        if (n == 0) return;
+
+        Node* nodes = node_pool.allocateBlock(n);
+        for (size_t i = 0; i < n; ++i) {
+            new (&nodes[i]) Node(key_arena.intern(sorted_entries[i].first), sorted_entries[i].second, BLACK, NIL, NIL, NIL);
+        }
+
+        size_t height = 0; // число уровней: floor(log2(n)) + 1
+        while ((static_cast<size_t>(1) << height) <= n) {
+            height++;
+        }
+        size_t red_depth = (height > 1) ? height - 1 : SIZE_MAX;
+        root = buildBalanced(nodes, 0, n, 0, red_depth, NIL);
+        rightmost = &nodes[n - 1];
+    }
+
+    template<typename Visitor>
+    void forEachInOrder(Visitor visit) const {
+        forEachInOrderRecursive(root, visit);
+    }
+
+    // узлы и ключи освобождаются целыми блоками, без обхода дерева
+    void clear() {
+        node_pool.releaseAll();
+        root = NIL;
+        rightmost = NIL;
+        key_arena.release();
+    }
+
+    // Память узлов и ключей в байтах.
+    size_t memoryUsage() const {
+        return node_pool.bytesReserved() + key_arena.bytesReserved();
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        os << "{";
+        bool first = true;
+        inorderPrintRecursive(root, os, first);
+        os << "}";
+    }
+
+    void visualize(std::ostream& os = std::cout) const {
+        os << "Визуализация Красно-Черного Дерева (узлов: " << node_pool.liveNodes() << ", блоков пула: " << node_pool.slabCount()
+           << ", память ключей: " << key_arena.bytesReserved() << " байт):" << std::endl;
+        if (root == NIL) {
+            os << "<дерево пусто>" << std::endl;
+            return;
+        }
+
+        const int SPACE_INCREMENT = 15;
+        printTreeRecursive(root, SPACE_INCREMENT, 0, os);
+        os << std::endl << std::endl << "Конец визуализации." << std::endl;
+    }
+};
+
+
+class Dictionary {
+private:
+    RBTree rbt;
+    /*std::string toLowerASCII(std::string s) const {
+        std::transform(s.begin(), s.end(), s.begin(),
+                       [](unsigned char c){ return std::tolower(c); });
+        return s;
+    }*/
+
+public:
+    Dictionary() = default;
+
+    void addWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        //std::string word = toLowerASCII(word_raw);
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+
+        rbt.increment(word);
+    }
+
+    void removeWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        //std::string word = toLowerASCII(word_raw);
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+        rbt.remove(word);
+    }
+
+    bool findWord(std::string_view word_raw) const {
+        if (word_raw.empty()) return false;
+        //std::string word = toLowerASCII(word_raw);
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+
+        const int* count_ptr = rbt.search(word);
+        if (count_ptr) {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') найдено, частота: " << *count_ptr << std::endl;
+            return true;
+        } else {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') не найдено." << std::endl;
+            return false;
+        }
+    }
+
+    void clear() {
+        rbt.clear();
+        std::cout << "Словарь (КЧ-дерево) очищен." << std::endl;
+    }
+
+    void loadFromFile(const std::string& filepath, bool append = false) {
+        if (!append) {
+            clear();
+        }
+        try {
+            forEachWordInFile(filepath, [this](std::string_view word) { addWord(word); });
+            std::cout << "Словарь загружен/дополнен из файла '" << filepath << "' (КЧ-дерево)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файла (КЧ-дерево): " << e.what() << std::endl;
+        }
+    }
+
+    // Частоты считаются параллельно в хеш-таблицах (countWordsInFilesParallel), дерево получает
+    // каждое различное слово один раз.
+    void loadFromFiles(const std::vector<std::string>& filepaths, bool append = false, size_t num_threads = 0) {
+        if (!append) {
+            clear();
+        }
+        try {
+            std::vector<DictionaryWithHashTable::HashTable> counts = DictionaryWithHashTable::countWordsInFilesParallel(filepaths, num_threads);
+            for (const auto& part : counts) {
+                part.forEach([this](const DictionaryWithHashTable::HashNode& node) { rbt.increment(node.key, node.value); });
+            }
+            std::cout << "Словарь загружен/дополнен из " << filepaths.size() << " файлов (КЧ-дерево, параллельно)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файлов (КЧ-дерево): " << e.what() << std::endl;
+        }
+    }
+
+    // Выгрузка в формате "слово частота" по строке на слово, в порядке возрастания ключей.
+    void saveToFile(const std::string& filepath) const {
+        std::ofstream out(filepath, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Не удалось открыть файл для записи: " + filepath);
+        }
+        rbt.forEachInOrder([&out](std::string_view key, int value) {
+            out << key << ' ' << value << '\n';
+        });
+        std::cout << "Словарь (КЧ-дерево) сохранен в файл '" << filepath << "'." << std::endl;
+    }
+
+    // Восстановление из файла saveToFile: ключи уже упорядочены, поэтому дерево строится за O(n).
+    void loadSortedFromFile(const std::string& filepath) {
+        std::string content = readFileToString(filepath);
+        std::vector<std::pair<std::string_view, int>> entries;
+        size_t line_start = 0;
+        while (line_start < content.size()) {
+            size_t line_end = content.find('\n', line_start);
+            if (line_end == std::string::npos) line_end = content.size();
+            std::string_view line(content.data() + line_start, line_end - line_start);
+            line_start = line_end + 1;
+            if (line.empty()) continue;
+
+            size_t space = line.rfind(' ');
+            int value = 0;
+            if (space == std::string_view::npos
+                || std::from_chars(line.data() + space + 1, line.data() + line.size(), value).ec != std::errc()) {
+                throw std::runtime_error("Некорректная строка в файле '" + filepath + "': " + std::string(line));
+            }
+            entries.emplace_back(line.substr(0, space), value);
+        }
+        rbt.assignSorted(entries);
+        std::cout << "Словарь (КЧ-дерево) восстановлен из файла '" << filepath << "': " << entries.size() << " слов." << std::endl;
+    }
+
+    // Слова с заданным префиксом (автодополнение), не более limit штук.
+    std::vector<std::pair<std::string, int>> wordsWithPrefix(std::string_view prefix_raw, size_t limit = SIZE_MAX) const {
+        NormalizedKey prefix(prefix_raw);
+        std::vector<std::pair<std::string, int>> result;
+        if (limit == 0) return result;
+        rbt.forEachWithPrefix(prefix.view(), [&result, limit](std::string_view key, int value) {
+            result.emplace_back(std::string(key), value);
+            return result.size() < limit;
+        });
+        return result;
+    }
+
+    size_t countWordsWithPrefix(std::string_view prefix_raw) const {
+        NormalizedKey prefix(prefix_raw);
+        return rbt.countWithPrefix(prefix.view());
+    }
+
+    long long frequencyWithPrefix(std::string_view prefix_raw) const {
+        NormalizedKey prefix(prefix_raw);
+        return rbt.frequencyWithPrefix(prefix.view());
+    }
+
+    size_t rankOf(std::string_view word_raw) const {
+        NormalizedKey key(word_raw);
+        return rbt.rank(key.view());
+    }
+
+    const Node* wordAtRank(size_t k) const {
+        return rbt.select(k);
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        rbt.print(os);
+    }
+
+    void visualizeStructure(std::ostream& os = std::cout) const {
+        rbt.visualize(os);
+    }
+};
+
+// Узел персистентного дерева неизменяем после создания; поддеревья разделяются между версиями.
+struct PersistentNode;
+using PersistentNodePtr = std::shared_ptr<const PersistentNode>;
+
+struct PersistentNode {
+    Color color;
+    std::string key;
+    int value;
+    PersistentNodePtr left, right;
+
+    PersistentNode(Color c, PersistentNodePtr l, std::string k, int v, PersistentNodePtr r)
+        : color(c), key(std::move(k)), value(v), left(std::move(l)), right(std::move(r)) {}
+};
+
+// Персистентное КЧ-дерево с копированием пути: insert/remove не меняют текущую версию,
+// а возвращают новую, в которой заново созданы только O(log n) узлов на пути от корня.
+// Вставка - по Окасаки, удаление - по Карсу (Kahrs). Версия - это значение: копирование стоит
+// одного shared_ptr, старые узлы освобождаются подсчетом ссылок, когда их не держит ни одна версия.
+class PersistentRBTree {
+private:
+    PersistentNodePtr root;
+    size_t count = 0;
+
+    PersistentRBTree(PersistentNodePtr r, size_t n) : root(std::move(r)), count(n) {}
+
+    static bool isRed(const PersistentNodePtr& node) {
+        return node && node->color == RED;
+    }
+
+    static bool isBlack(const PersistentNodePtr& node) {
+        return node && node->color == BLACK;
+    }
+
+    static PersistentNodePtr make(Color color, PersistentNodePtr left, const std::string& key, int value,
+                                  PersistentNodePtr right) {
+        return std::make_shared<const PersistentNode>(color, std::move(left), key, value, std::move(right));
+    }
+
+    static PersistentNodePtr recolor(const PersistentNodePtr& node, Color color) {
+        return make(color, node->left, node->key, node->value, node->right);
+    }
+
+    // Устраняет два красных узла подряд под черным узлом (key, value) либо перекрашивает двух красных детей.
+    static PersistentNodePtr balance(const PersistentNodePtr& a, const std::string& key, int value,
+                                     const PersistentNodePtr& b) {
+        if (isRed(a) && isRed(b)) {
+            return make(RED, recolor(a, BLACK), key, value, recolor(b, BLACK));
+        }
+        if (isRed(a) && isRed(a->left)) {
+            return make(RED, recolor(a->left, BLACK), a->key, a->value, make(BLACK, a->right, key, value, b));
+        }
+        if (isRed(a) && isRed(a->right)) {
+            return make(RED, make(BLACK, a->left, a->key, a->value, a->right->left), a->right->key, a->right->value,
+                        make(BLACK, a->right->right, key, value, b));
+        }
+        if (isRed(b) && isRed(b->right)) {
+            return make(RED, make(BLACK, a, key, value, b->left), b->key, b->value, recolor(b->right, BLACK));
+        }
+        if (isRed(b) && isRed(b->left)) {
+            return make(RED, make(BLACK, a, key, value, b->left->left), b->left->key, b->left->value,
+                        make(BLACK, b->left->right, b->key, b->value, b->right));
+        }
+        return make(BLACK, a, key, value, b);
+    }
+
+    // Перекрашивает черный узел в красный; красный или пустой узел здесь означает нарушение инвариантов.
+    static PersistentNodePtr redden(const PersistentNodePtr& node) {
+        if (!isBlack(node)) {
+            throw std::logic_error("Персистентное КЧ-дерево: нарушены инварианты при удалении.");
+        }
+        return recolor(node, RED);
+    }
+
+    // Левое поддерево стало на единицу ниже по черной высоте.
+    static PersistentNodePtr balanceLeft(const PersistentNodePtr& left, const std::string& key, int value,
+                                         const PersistentNodePtr& right) {
+        if (isRed(left)) {
+            return make(RED, recolor(left, BLACK), key, value, right);
+        }
+        if (isBlack(right)) {
+            return balance(left, key, value, recolor(right, RED));
+        }
+        if (isRed(right) && isBlack(right->left)) {
+            return make(RED, make(BLACK, left, key, value, right->left->left), right->left->key, right->left->value,
+                        balance(right->left->right, right->key, right->value, redden(right->right)));
+        }
+        throw std::logic_error("Персистентное КЧ-дерево: нарушены инварианты при удалении.");
+    }
+
+    // Правое поддерево стало на единицу ниже по черной высоте.
+    static PersistentNodePtr balanceRight(const PersistentNodePtr& left, const std::string& key, int value,
+                                          const PersistentNodePtr& right) {
+        if (isRed(right)) {
+            return make(RED, left, key, value, recolor(right, BLACK));
+        }
+        if (isBlack(left)) {
+            return balance(recolor(left, RED), key, value, right);
+        }
+        if (isRed(left) && isBlack(left->right)) {
+            return make(RED, balance(redden(left->left), left->key, left->value, left->right->left),
+                        left->right->key, left->right->value, make(BLACK, left->right->right, key, value, right));
+        }
+        throw std::logic_error("Персистентное КЧ-дерево: нарушены инварианты при удалении.");
+    }
+
+    // Слияние поддеревьев удаляемого узла (все ключи a меньше ключей b).
+    static PersistentNodePtr fuse(const PersistentNodePtr& a, const PersistentNodePtr& b) {
+        if (!a) return b;
+        if (!b) return a;
+        if (isRed(a) && isRed(b)) {
+            PersistentNodePtr middle = fuse(a->right, b->left);
+            if (isRed(middle)) {
+                return make(RED, make(RED, a->left, a->key, a->value, middle->left), middle->key, middle->value,
+                            make(RED, middle->right, b->key, b->value, b->right));
+            }
+            return make(RED, a->left, a->key, a->value, make(RED, middle, b->key, b->value, b->right));
+        }
+        if (isBlack(a) && isBlack(b)) {
+            PersistentNodePtr middle = fuse(a->right, b->left);
+            if (isRed(middle)) {
+                return make(RED, make(BLACK, a->left, a->key, a->value, middle->left), middle->key, middle->value,
+                            make(BLACK, middle->right, b->key, b->value, b->right));
+            }
+            return balanceLeft(a->left, a->key, a->value, make(BLACK, middle, b->key, b->value, b->right));
+        }
+        if (isRed(b)) {
+            return make(RED, fuse(a, b->left), b->key, b->value, b->right);
+        }
+        return make(RED, a->left, a->key, a->value, fuse(a->right, b));
+    }
+
+    // Спуск с копированием пути. add == true: value прибавляется к существующему значению.
+    static PersistentNodePtr insertRecursive(const PersistentNodePtr& node, std::string_view key, int value, bool add,
+                                             bool& inserted) {
+        if (!node) {
+            inserted = true;
+            return make(RED, nullptr, std::string(key), value, nullptr);
+        }
+        int order = key.compare(node->key);
+        if (order < 0) {
+            PersistentNodePtr left = insertRecursive(node->left, key, value, add, inserted);
+            return node->color == BLACK ? balance(left, node->key, node->value, node->right)
+                                        : make(RED, std::move(left), node->key, node->value, node->right);
+        }
+        if (order > 0) {
+            PersistentNodePtr right = insertRecursive(node->right, key, value, add, inserted);
+            return node->color == BLACK ? balance(node->left, node->key, node->value, right)
+                                        : make(RED, node->left, node->key, node->value, std::move(right));
+        }
+        return make(node->color, node->left, node->key, add ? node->value + value : value, node->right);
+    }
+
+    static PersistentNodePtr removeRecursive(const PersistentNodePtr& node, std::string_view key) {
+        if (!node) return nullptr;
+        int order = key.compare(node->key);
+        if (order < 0) {
+            PersistentNodePtr left = removeRecursive(node->left, key);
+            return isBlack(node->left) ? balanceLeft(left, node->key, node->value, node->right)
+                                       : make(RED, std::move(left), node->key, node->value, node->right);
+        }
+        if (order > 0) {
+            PersistentNodePtr right = removeRecursive(node->right, key);
+            return isBlack(node->right) ? balanceRight(node->left, node->key, node->value, right)
+                                        : make(RED, node->left, node->key, node->value, std::move(right));
+        }
+        return fuse(node->left, node->right);
+    }
+
+    static PersistentNodePtr blackenRoot(PersistentNodePtr node) {
+        if (isRed(node)) {
+            return recolor(node, BLACK);
+        }
+        return node;
+    }
+
+    PersistentRBTree upsert(std::string_view key, int value, bool add) const {
+        bool inserted = false;
+        PersistentNodePtr next_root = blackenRoot(insertRecursive(root, key, value, add, inserted));
+        return PersistentRBTree(std::move(next_root), count + (inserted ? 1 : 0));
+    }
+
+    template<typename Visitor>
+    static void forEachInOrderRecursive(const PersistentNode* node, Visitor& visit) {
+        if (node) {
+            forEachInOrderRecursive(node->left.get(), visit);
+            visit(std::string_view(node->key), node->value);
+            forEachInOrderRecursive(node->right.get(), visit);
+        }
+    }
+
+    static void printTreeRecursive(const PersistentNode* node, int space_increment, int current_space, std::ostream& os) {
+        if (!node) return;
+        current_space += space_increment;
+        printTreeRecursive(node->right.get(), space_increment, current_space, os);
+        os << std::endl;
+        for (int i = space_increment; i < current_space; i++) {
+            os << " ";
+        }
+        os << "(\"" << node->key << "\":" << node->value << (node->color == RED ? " R" : " B") << ")";
+        printTreeRecursive(node->left.get(), space_increment, current_space, os);
+    }
+
+public:
+    PersistentRBTree() = default;
+
+    PersistentRBTree insert(std::string_view key, int value) const {
+        return upsert(key, value, false);
+    }
+
+    // Частота += delta; отсутствующий ключ появляется со значением delta.
+    PersistentRBTree increment(std::string_view key, int delta = 1) const {
+        return upsert(key, delta, true);
+    }
+
+    PersistentRBTree remove(std::string_view key) const {
+        if (!search(key)) return *this; // без копирования пути, если удалять нечего
+        return PersistentRBTree(blackenRoot(removeRecursive(root, key)), count - 1);
+    }
+
+    // Указатель действителен, пока жива эта версия.
+    const int* search(std::string_view key) const {
+        const PersistentNode* current = root.get();
+        while (current) {
+            int order = key.compare(current->key);
+            if (order == 0) return &current->value;
+            current = (order < 0) ? current->left.get() : current->right.get();
+        }
+        return nullptr;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    template<typename Visitor>
+    void forEachInOrder(Visitor visit) const {
+        forEachInOrderRecursive(root.get(), visit);
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        os << "{";
+        bool first = true;
+        forEachInOrder([&os, &first](std::string_view key, int value) {
+            if (!first) os << ", ";
+            os << "'" << key << "': " << value;
+            first = false;
+        });
+        os << "}";
+    }
+
+    void visualize(std::ostream& os = std::cout) const {
+        os << "Визуализация персистентного КЧ-дерева (узлов: " << count
+           << ", владельцев корня: " << root.use_count() << "):" << std::endl;
+        if (!root) {
+            os << "<дерево пусто>" << std::endl;
+            return;
+        }
+        const int SPACE_INCREMENT = 15;
+        printTreeRecursive(root.get(), SPACE_INCREMENT, 0, os);
+        os << std::endl << std::endl << "Конец визуализации." << std::endl;
+    }
+};
+
+// Словарь с версиями: писатели (по одному за раз) строят новую версию PersistentRBTree и публикуют ее
+// атомарной заменой указателя, снятая версия освобождается через EpochReclaimer (как в SnapshotDictionary).
+// Короткие чтения идут прямо по опубликованной версии; snapshot() отдает копию версии (копируется только
+// указатель на корень), с которой можно работать сколько угодно долго, не мешая записи.
+class VersionedDictionary {
+public:
+    using Version = PersistentRBTree;
+
+private:
+    std::atomic<const PersistentRBTree*> current;
+    mutable DictionaryWithHashTable::EpochReclaimer<const PersistentRBTree> reclaimer;
+    std::mutex writer_mutex;  // только для писателей
+    std::atomic<uint64_t> published_versions{0};
+
+    // вызывается под writer_mutex; писатель читает current без ReadGuard: освобождать версии может только он сам
+    void publish(PersistentRBTree next) {
+        const PersistentRBTree* old_version = current.exchange(new PersistentRBTree(std::move(next)));
+        reclaimer.retire(std::unique_ptr<const PersistentRBTree>(old_version));
+        published_versions.fetch_add(1);
+    }
+
+public:
+    VersionedDictionary() : current(new PersistentRBTree()) {}
+
+    ~VersionedDictionary() {
+        delete current.load();
+    }
+
+    VersionedDictionary(const VersionedDictionary&) = delete;
+    VersionedDictionary& operator=(const VersionedDictionary&) = delete;
+
+    // Неизменяемая версия на текущий момент.
+    Version snapshot() const {
+        DictionaryWithHashTable::EpochReclaimer<const PersistentRBTree>::ReadGuard guard(reclaimer);
+        return *current.load();
+    }
+
+    void addWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        NormalizedKey key(word_raw);
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        publish(current.load()->increment(key.view()));
+    }
+
+    void removeWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        NormalizedKey key(word_raw);
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        publish(current.load()->remove(key.view()));
+    }
+
+    int frequency(std::string_view word_raw) const {
+        NormalizedKey key(word_raw);
+        DictionaryWithHashTable::EpochReclaimer<const PersistentRBTree>::ReadGuard guard(reclaimer);
+        const int* count_ptr = current.load()->search(key.view());
+        return count_ptr ? *count_ptr : 0;
+    }
+
+    bool findWord(std::string_view word_raw) const {
+        if (word_raw.empty()) return false;
+        NormalizedKey key(word_raw);
+        Version version = snapshot();
+        const int* count_ptr = version.search(key.view());
+        if (count_ptr) {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << key.view() << "') найдено, частота: " << *count_ptr << std::endl;
+            return true;
+        } else {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << key.view() << "') не найдено." << std::endl;
+            return false;
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        publish(PersistentRBTree());
+        std::cout << "Словарь (версии КЧ-дерева) очищен." << std::endl;
+    }
+
+    // Частоты файла сначала считаются в обычном RBTree, затем каждое различное слово один раз
+    // переносится в новую версию; читатели видят файл либо целиком, либо не видят вовсе.
+    void loadFromFile(const std::string& filepath, bool append = false) {
+        try {
+            RBTree counts;
+            forEachWordInFile(filepath, [&counts](std::string_view word) {
+                NormalizedKey key(word);
+                counts.increment(key.view());
+            });
+
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            PersistentRBTree next = append ? *current.load() : PersistentRBTree();
+            counts.forEachInOrder([&next](std::string_view key, int value) {
+                next = next.increment(key, value);
+            });
+            publish(std::move(next));
+            std::cout << "Словарь загружен/дополнен из файла '" << filepath << "' (версии КЧ-дерева)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файла (версии КЧ-дерева): " << e.what() << std::endl;
+        }
+    }
+
+    void loadFromFiles(const std::vector<std::string>& filepaths, bool append = false, size_t num_threads = 0) {
+        try {
+            std::vector<DictionaryWithHashTable::HashTable> counts = DictionaryWithHashTable::countWordsInFilesParallel(filepaths, num_threads);
+
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            PersistentRBTree next = append ? *current.load() : PersistentRBTree();
+            for (const auto& part : counts) {
+                part.forEach([&next](const DictionaryWithHashTable::HashNode& node) {
+                    next = next.increment(node.key, node.value);
+                });
+            }
+            publish(std::move(next));
+            std::cout << "Словарь загружен/дополнен из " << filepaths.size() << " файлов (версии КЧ-дерева, параллельно)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файлов (версии КЧ-дерева): " << e.what() << std::endl;
+        }
+    }
+
+    // Выгрузка снимка в формате RBTree-словаря ("слово частота"); запись в словарь при этом не блокируется.
+    void exportSnapshot(const std::string& filepath) const {
+        Version version = snapshot();
+        std::ofstream out(filepath, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Не удалось открыть файл для записи: " + filepath);
+        }
+        version.forEachInOrder([&out](std::string_view key, int value) {
+            out << key << ' ' << value << '\n';
+        });
+        std::cout << "Снимок словаря (" << version.size() << " слов) сохранен в файл '" << filepath << "'." << std::endl;
+    }
+
+    size_t size() const {
+        DictionaryWithHashTable::EpochReclaimer<const PersistentRBTree>::ReadGuard guard(reclaimer);
+        return current.load()->size();
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        DictionaryWithHashTable::EpochReclaimer<const PersistentRBTree>::ReadGuard guard(reclaimer);
+        current.load()->print(os);
+    }
+
+    void visualizeStructure(std::ostream& os = std::cout) const {
+        DictionaryWithHashTable::EpochReclaimer<const PersistentRBTree>::ReadGuard guard(reclaimer);
+        os << "Опубликовано версий: " << published_versions.load()
+           << ", ожидает освобождения: " << reclaimer.pendingCount() << std::endl;
+        current.load()->visualize(os);
+    }
+};
+
+}
+
+
+namespace DictionaryWithBPlusTree {
+
+constexpr size_t NODE_CAPACITY = 16;
+
+// Первые 8 байт ключа в порядке big-endian: сравнение префиксов как чисел совпадает
+// с лексикографическим порядком, поэтому полные строки сравниваются только при равных префиксах.
+inline uint64_t keyPrefix(std::string_view key) {
+    uint64_t prefix = 0;
+    size_t n = std::min<size_t>(key.size(), 8);
+    for (size_t i = 0; i < n; ++i) {
+        prefix |= static_cast<uint64_t>(static_cast<unsigned char>(key[i])) << (56 - 8 * i);
+    }
+    return prefix;
+}
+
+inline int compareKeys(uint64_t prefix_a, std::string_view a, uint64_t prefix_b, std::string_view b) {
+    if (prefix_a != prefix_b) {
+        return prefix_a < prefix_b ? -1 : 1;
+    }
+    if (a.size() <= 8 && b.size() <= 8) {
+        return (a.size() < b.size()) ? -1 : (a.size() > b.size() ? 1 : 0);
+    }
+    return a.compare(b);
+}
+
+struct alignas(64) BPlusNode {
+    bool is_leaf;
+    uint16_t count;
+    uint64_t prefixes[NODE_CAPACITY];
+    std::string_view keys[NODE_CAPACITY]; // байты ключей лежат в StringArena дерева
+
+    explicit BPlusNode(bool leaf) : is_leaf(leaf), count(0) {}
+};
+
+struct LeafNode : BPlusNode {
+    int values[NODE_CAPACITY];
+    LeafNode* next;
+
+    LeafNode() : BPlusNode(true), next(nullptr) {}
+};
+
+// children[i] содержит ключи из [keys[i-1], keys[i])
+struct InnerNode : BPlusNode {
+    BPlusNode* children[NODE_CAPACITY + 1];
+
+    InnerNode() : BPlusNode(false) {}
+};
+
+class BPlusTree {
+private:
+    BPlusNode* root;
+    StringArena key_arena;
+    size_t num_elements;
+
+    struct SplitResult {
+        BPlusNode* right = nullptr;
+        uint64_t prefix = 0;
+        std::string_view separator;
+    };
+
+    // первый индекс i, для которого keys[i] >= key
+    static size_t lowerBound(const BPlusNode* node, uint64_t prefix, std::string_view key) {
+        size_t i = 0;
+        while (i < node->count && compareKeys(node->prefixes[i], node->keys[i], prefix, key) < 0) {
+            ++i;
+        }
+        return i;
+    }
+
+    // первый индекс i, для которого keys[i] > key
+    static size_t upperBound(const BPlusNode* node, uint64_t prefix, std::string_view key) {
+        size_t i = 0;
+        while (i < node->count && compareKeys(node->prefixes[i], node->keys[i], prefix, key) <= 0) {
+            ++i;
+        }
+        return i;
+    }
+
+    LeafNode* findLeaf(uint64_t prefix, std::string_view key) const {
+        BPlusNode* node = root;
+        while (!node->is_leaf) {
+            InnerNode* inner = static_cast<InnerNode*>(node);
+            node = inner->children[upperBound(inner, prefix, key)];
+        }
+        return static_cast<LeafNode*>(node);
+    }
+
+    int* insertIntoLeaf(LeafNode* leaf, uint64_t prefix, std::string_view key, SplitResult& split) {
+        size_t pos = lowerBound(leaf, prefix, key);
+        if (pos < leaf->count && compareKeys(leaf->prefixes[pos], leaf->keys[pos], prefix, key) == 0) {
+            return &leaf->values[pos];
+        }
+
+        if (leaf->count == NODE_CAPACITY) {
+            LeafNode* right = new LeafNode();
+            size_t half = NODE_CAPACITY / 2;
+            for (size_t i = half; i < NODE_CAPACITY; ++i) {
+                right->prefixes[i - half] = leaf->prefixes[i];
+                right->keys[i - half] = leaf->keys[i];
+                right->values[i - half] = leaf->values[i];
+            }
+            right->count = static_cast<uint16_t>(NODE_CAPACITY - half);
+            leaf->count = static_cast<uint16_t>(half);
+            right->next = leaf->next;
+            leaf->next = right;
+            split.right = right;
+            split.prefix = right->prefixes[0];
+            split.separator = right->keys[0];
+            if (pos > half) {
+                pos -= half;
+                leaf = right;
+            }
+        }
+
+        for (size_t i = leaf->count; i > pos; --i) {
+            leaf->prefixes[i] = leaf->prefixes[i - 1];
+            leaf->keys[i] = leaf->keys[i - 1];
+            leaf->values[i] = leaf->values[i - 1];
+        }
+        leaf->prefixes[pos] = prefix;
+        leaf->keys[pos] = key_arena.intern(key);
+        leaf->values[pos] = 0;
+        leaf->count++;
+        num_elements++;
+        return &leaf->values[pos];
+    }
+
+    static void insertIntoInner(InnerNode* inner, size_t pos, const SplitResult& child_split) {
+        for (size_t i = inner->count; i > pos; --i) {
+            inner->prefixes[i] = inner->prefixes[i - 1];
+            inner->keys[i] = inner->keys[i - 1];
+            inner->children[i + 1] = inner->children[i];
+        }
+        inner->prefixes[pos] = child_split.prefix;
+        inner->keys[pos] = child_split.separator;
+        inner->children[pos + 1] = child_split.right;
+        inner->count++;
+    }
+
+    int* insertRecursive(BPlusNode* node, uint64_t prefix, std::string_view key, SplitResult& split) {
+        if (node->is_leaf) {
+            return insertIntoLeaf(static_cast<LeafNode*>(node), prefix, key, split);
+        }
+
+        InnerNode* inner = static_cast<InnerNode*>(node);
+        size_t child_index = upperBound(inner, prefix, key);
+        SplitResult child_split;
+        int* result = insertRecursive(inner->children[child_index], prefix, key, child_split);
+        if (child_split.right == nullptr) {
+            return result;
+        }
+
+        if (inner->count < NODE_CAPACITY) {
+            insertIntoInner(inner, child_index, child_split);
+            return result;
+        }
+
+        // средний ключ поднимается наверх, правая половина уходит в новый узел
+        InnerNode* right = new InnerNode();
+        size_t mid = NODE_CAPACITY / 2;
+        for (size_t i = mid + 1; i < NODE_CAPACITY; ++i) {
+            right->prefixes[i - mid - 1] = inner->prefixes[i];
+            right->keys[i - mid - 1] = inner->keys[i];
+        }
+        for (size_t i = mid + 1; i <= NODE_CAPACITY; ++i) {
+            right->children[i - mid - 1] = inner->children[i];
+        }
+        right->count = static_cast<uint16_t>(NODE_CAPACITY - mid - 1);
+        inner->count = static_cast<uint16_t>(mid);
+        split.right = right;
+        split.prefix = inner->prefixes[mid];
+        split.separator = inner->keys[mid];
+
+        if (child_index <= mid) {
+            insertIntoInner(inner, child_index, child_split);
         } else {
-            x->parent->right = y;
+            insertIntoInner(right, child_index - mid - 1, child_split);
         }
-        y->left = x;
-        x->parent = y;
+        return result;
     }
 
-    void rightRotate(Node* y) {
-        Node* x = y->left;
-        y->left = x->right;
-        if (x->right != NIL) {
-            x->right->parent = y;
+    void destroyRecursive(BPlusNode* node) {
+        if (node->is_leaf) {
+            delete static_cast<LeafNode*>(node);
+            return;
         }
-        x->parent = y->parent;
-        if (y->parent == NIL) {
-            root = x;
-        } else if (y == y->parent->right) {
-            y->parent->right = x;
-        } else {
-            y->parent->left = x;
+        InnerNode* inner = static_cast<InnerNode*>(node);
+        for (size_t i = 0; i <= inner->count; ++i) {
+            destroyRecursive(inner->children[i]);
         }
-        x->right = y;
-        y->parent = x;
+        delete inner;
     }
 
-    void insertFixup(Node* z) {
-        while (z->parent->color == RED) {
-            if (z->parent == z->parent->parent->left) {
-                Node* y = z->parent->parent->right;
-                if (y->color == RED) {
-                    z->parent->color = BLACK;
-                    y->color = BLACK;
-                    z->parent->parent->color = RED;
-                    z = z->parent->parent;
-                } else {
-                    if (z == z->parent->right) {
-                        z = z->parent;
-                        leftRotate(z);
+    const LeafNode* leftmostLeaf() const {
+        const BPlusNode* node = root;
+        while (!node->is_leaf) {
+            node = static_cast<const InnerNode*>(node)->children[0];
+        }
+        return static_cast<const LeafNode*>(node);
+    }
+
+public:
+    BPlusTree() : root(new LeafNode()), num_elements(0) {}
+
+    ~BPlusTree() {
+        destroyRecursive(root);
+    }
+
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
+    // Один спуск: возвращает счетчик ключа, при отсутствии вставляет ключ со значением 0.
+    int& findOrInsert(std::string_view key) {
+        SplitResult split;
+        int* value = insertRecursive(root, keyPrefix(key), key, split);
+        if (split.right != nullptr) {
+            InnerNode* new_root = new InnerNode();
+            new_root->children[0] = root;
+            insertIntoInner(new_root, 0, split);
+            root = new_root;
+        }
+        return *value;
+    }
+
+    void insert(std::string_view key, int value) {
+        findOrInsert(key) = value;
+    }
+
+    int* search(std::string_view key) {
+        uint64_t prefix = keyPrefix(key);
+        LeafNode* leaf = findLeaf(prefix, key);
+        size_t pos = lowerBound(leaf, prefix, key);
+        if (pos < leaf->count && compareKeys(leaf->prefixes[pos], leaf->keys[pos], prefix, key) == 0) {
+            return &leaf->values[pos];
+        }
+        return nullptr;
+    }
+
+    const int* search(std::string_view key) const {
+        return const_cast<BPlusTree*>(this)->search(key);
+    }
+
+    // Удаление без слияния узлов: лист может стать неполным или пустым, разделители остаются корректными.
+    bool remove(std::string_view key) {
+        uint64_t prefix = keyPrefix(key);
+        LeafNode* leaf = findLeaf(prefix, key);
+        size_t pos = lowerBound(leaf, prefix, key);
+        if (pos >= leaf->count || compareKeys(leaf->prefixes[pos], leaf->keys[pos], prefix, key) != 0) {
+            return false;
+        }
+        for (size_t i = pos + 1; i < leaf->count; ++i) {
+            leaf->prefixes[i - 1] = leaf->prefixes[i];
+            leaf->keys[i - 1] = leaf->keys[i];
+            leaf->values[i - 1] = leaf->values[i];
+        }
+        leaf->count--;
+        num_elements--;
+        return true;
+    }
+
+    void clear() {
+        destroyRecursive(root);
+        root = new LeafNode();
+        num_elements = 0;
+        key_arena.release();
+    }
+
+    size_t size() const {
+        return num_elements;
+    }
+
+    // упорядоченный обход по цепочке листьев, без рекурсии по внутренним узлам
+    void print(std::ostream& os = std::cout) const {
+        os << "{";
+        bool first_item = true;
+        for (const LeafNode* leaf = leftmostLeaf(); leaf != nullptr; leaf = leaf->next) {
+            for (size_t i = 0; i < leaf->count; ++i) {
+                if (!first_item) {
+                    os << ", ";
+                }
+                os << "'" << leaf->keys[i] << "': " << leaf->values[i];
+                first_item = false;
+            }
+        }
+        os << "}";
+    }
+
+    void visualize(std::ostream& os = std::cout) const {
+        os << "Визуализация B+-дерева (элементы: " << num_elements << ", емкость узла: " << NODE_CAPACITY
+           << ", память ключей: " << key_arena.bytesReserved() << " байт):" << std::endl;
+        std::vector<const BPlusNode*> level = {root};
+        size_t depth = 0;
+        while (!level.empty()) {
+            os << "Уровень " << depth << ": ";
+            std::vector<const BPlusNode*> next_level;
+            for (const BPlusNode* node : level) {
+                os << "[";
+                for (size_t i = 0; i < node->count; ++i) {
+                    if (i > 0) os << " | ";
+                    os << node->keys[i];
+                    if (node->is_leaf) {
+                        os << ":" << static_cast<const LeafNode*>(node)->values[i];
                     }
-                    z->parent->color = BLACK;
-                    z->parent->parent->color = RED;
-                    rightRotate(z->parent->parent);
                 }
-            } else {
-                Node* y = z->parent->parent->left;
-                if (y->color == RED) {
-                    z->parent->color = BLACK;
-                    y->color = BLACK;
-                    z->parent->parent->color = RED;
-                    z = z->parent->parent;
-                } else {
-                    if (z == z->parent->left) {
-                        z = z->parent;
-                        rightRotate(z);
+                os << "] ";
+                if (!node->is_leaf) {
+                    const InnerNode* inner = static_cast<const InnerNode*>(node);
+                    for (size_t i = 0; i <= inner->count; ++i) {
+                        next_level.push_back(inner->children[i]);
                     }
-                    z->parent->color = BLACK;
-                    z->parent->parent->color = RED;
-                    leftRotate(z->parent->parent);
                 }
             }
-             if (z == root) break; // Оптимизация: если z дошел до корня
+            os << std::endl;
+            level.swap(next_level);
+            depth++;
         }
-        root->color = BLACK;
     }
+};
 
-    Node* findNode(const std::string& key) const {
-        Node* current = root;
-        while (current != NIL && current->key != key) {
-            if (key < current->key) {
-                current = current->left;
-            } else {
-                current = current->right;
+class Dictionary {
+private:
+    BPlusTree tree;
+
+public:
+    Dictionary() = default;
+
+    void addWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        NormalizedKey key(word_raw);
+        tree.findOrInsert(key.view())++;
+    }
+
+    void removeWord(std::string_view word_raw) {
+        if (word_raw.empty()) return;
+        NormalizedKey key(word_raw);
+        tree.remove(key.view());
+    }
+
+    bool findWord(std::string_view word_raw) const {
+        if (word_raw.empty()) return false;
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
+
+        const int* count_ptr = tree.search(word);
+        if (count_ptr) {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') найдено, частота: " << *count_ptr << std::endl;
+            return true;
+        } else {
+            std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') не найдено." << std::endl;
+            return false;
+        }
+    }
+
+    void clear() {
+        tree.clear();
+        std::cout << "Словарь (B+-дерево) очищен." << std::endl;
+    }
+
+    void loadFromFile(const std::string& filepath, bool append = false) {
+        if (!append) {
+            clear();
+        }
+        try {
+            forEachWordInFile(filepath, [this](std::string_view word) { addWord(word); });
+            std::cout << "Словарь загружен/дополнен из файла '" << filepath << "' (B+-дерево)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файла (B+-дерево): " << e.what() << std::endl;
+        }
+    }
+
+    void loadFromFiles(const std::vector<std::string>& filepaths, bool append = false, size_t num_threads = 0) {
+        if (!append) {
+            clear();
+        }
+        try {
+            std::vector<DictionaryWithHashTable::HashTable> counts = DictionaryWithHashTable::countWordsInFilesParallel(filepaths, num_threads);
+            for (const auto& part : counts) {
+                part.forEach([this](const DictionaryWithHashTable::HashNode& node) { tree.findOrInsert(node.key) += node.value; });
             }
+            std::cout << "Словарь загружен/дополнен из " << filepaths.size() << " файлов (B+-дерево, параллельно)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файлов (B+-дерево): " << e.what() << std::endl;
         }
-        return current;
     }
 
-    void transplant(Node* u, Node* v) {
-        if (u->parent == NIL) {
-            root = v;
-        } else if (u == u->parent->left) {
-            u->parent->left = v;
+    void print(std::ostream& os = std::cout) const {
+        tree.print(os);
+    }
+
+    void visualizeStructure(std::ostream& os = std::cout) const {
+        tree.visualize(os);
+    }
+};
+
+}
+
+
+namespace DictionaryWithART {
+
+enum ArtNodeType : uint8_t { ART_LEAF, ART_NODE4, ART_NODE16, ART_NODE48, ART_NODE256 };
+
+struct ArtNode {
+    ArtNodeType type;
+
+    explicit ArtNode(ArtNodeType t) : type(t) {}
+};
+
+// Лист лежит в StringArena дерева вместе с ключом: заголовок, за ним все байты ключа, отдельного
+// выделения под лист нет. Суффикс листа - байты ключа после глубины, на которой лист висит в дереве.
+struct ArtLeaf : ArtNode {
+    int value;
+    uint32_t key_len;
+
+    explicit ArtLeaf(uint32_t len) : ArtNode(ART_LEAF), value(0), key_len(len) {}
+
+    std::string_view key() const {
+        return std::string_view(reinterpret_cast<const char*>(this) + sizeof(ArtLeaf), key_len);
+    }
+};
+
+// Внутренний узел: сжатый путь prefix и terminal - ключ, заканчивающийся ровно в этом узле
+// (например, "по" при наличии "пол"); дети - по следующему байту ключа.
+// prefix указывает внутрь ключа одного из листов на глубину узла, поэтому перед ним в памяти
+// лежит весь путь от корня - на этом держится склейка путей в compact() без новой памяти.
+struct ArtInner : ArtNode {
+    uint16_t num_children;
+    uint32_t prefix_len;
+    const char* prefix;
+    ArtLeaf* terminal;
+
+    ArtInner(ArtNodeType t, std::string_view p)
+        : ArtNode(t), num_children(0), prefix_len(static_cast<uint32_t>(p.size())), prefix(p.data()), terminal(nullptr) {}
+
+    std::string_view prefixView() const {
+        return std::string_view(prefix, prefix_len);
+    }
+
+    void setPrefix(std::string_view p) {
+        prefix = p.data();
+        prefix_len = static_cast<uint32_t>(p.size());
+    }
+};
+
+// keys упорядочены по возрастанию
+struct ArtNode4 : ArtInner {
+    uint8_t keys[4] = {};
+    ArtNode* children[4] = {};
+
+    explicit ArtNode4(std::string_view p) : ArtInner(ART_NODE4, p) {}
+};
+
+struct ArtNode16 : ArtInner {
+    uint8_t keys[16] = {};
+    ArtNode* children[16] = {};
+
+    explicit ArtNode16(std::string_view p) : ArtInner(ART_NODE16, p) {}
+};
+
+// child_index[byte] - позиция ребенка в children плюс один, 0 - ребенка нет
+struct ArtNode48 : ArtInner {
+    uint8_t child_index[256] = {};
+    ArtNode* children[48] = {};
+
+    explicit ArtNode48(std::string_view p) : ArtInner(ART_NODE48, p) {}
+};
+
+struct ArtNode256 : ArtInner {
+    ArtNode* children[256] = {};
+
+    explicit ArtNode256(std::string_view p) : ArtInner(ART_NODE256, p) {}
+};
+
+inline unsigned countTrailingZeros(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+    unsigned n = 0;
+    while ((mask & 1u) == 0) {
+        mask >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// Пул внутренних узлов одного размера: узлы выделяются подряд блоками по SLAB_BYTES,
+// освобожденные переиспользуются через список свободных (как NodePool КЧ-дерева).
+template<typename T>
+class ArtNodePool {
+private:
+    static constexpr size_t SLAB_BYTES = 64 * 1024;
+    static constexpr size_t NODES_PER_SLAB = std::max<size_t>(1, SLAB_BYTES / sizeof(T));
+
+    union Slot {
+        Slot* next; // пока узел свободен
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    size_t used_in_last_slab;
+    Slot* free_list;
+    size_t reserved_bytes;
+
+    static_assert(std::is_trivially_destructible<T>::value, "ArtNodePool освобождает узлы без вызова деструкторов");
+
+public:
+    ArtNodePool() : used_in_last_slab(NODES_PER_SLAB), free_list(nullptr), reserved_bytes(0) {}
+
+    ArtNodePool(const ArtNodePool&) = delete;
+    ArtNodePool& operator=(const ArtNodePool&) = delete;
+
+    template<typename... Args>
+    T* allocate(Args&&... args) {
+        Slot* slot;
+        if (free_list != nullptr) {
+            slot = free_list;
+            free_list = free_list->next;
         } else {
-            u->parent->right = v;
+            if (used_in_last_slab == NODES_PER_SLAB) {
+                slabs.push_back(std::make_unique<Slot[]>(NODES_PER_SLAB));
+                used_in_last_slab = 0;
+                reserved_bytes += heapAllocationSize(NODES_PER_SLAB * sizeof(Slot));
+            }
+            slot = &slabs.back()[used_in_last_slab++];
+        }
+        return new (&slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void deallocate(T* node) {
+        Slot* slot = reinterpret_cast<Slot*>(node);
+        slot->next = free_list;
+        free_list = slot;
+    }
+
+    void releaseAll() {
+        slabs.clear();
+        slabs.shrink_to_fit();
+        used_in_last_slab = NODES_PER_SLAB;
+        free_list = nullptr;
+        reserved_bytes = 0;
+    }
+
+    size_t bytesReserved() const {
+        return reserved_bytes;
+    }
+};
+
+// Адаптивное префиксное дерево (ART): размер внутреннего узла (4/16/48/256 детей) следует
+// за числом детей, цепочки узлов с одним ребенком сжаты в prefix. Порядок обхода - лексикографический.
+class AdaptiveRadixTree {
+private:
+    ArtNode* root;
+    StringArena key_arena; // ключи вместе с листами
+    std::tuple<ArtNodePool<ArtNode4>, ArtNodePool<ArtNode16>, ArtNodePool<ArtNode48>, ArtNodePool<ArtNode256>> pools;
+    size_t num_elements;
+    size_t dead_bytes; // листы удаленных ключей, еще лежащие в арене
+
+    static size_t commonPrefixLength(std::string_view a, std::string_view b) {
+        size_t n = std::min(a.size(), b.size());
+        size_t i = 0;
+        while (i < n && a[i] == b[i]) {
+            ++i;
+        }
+        return i;
+    }
+
+    static ArtNode** findChild(ArtInner* node, uint8_t byte) {
+        switch (node->type) {
+            case ART_NODE4: {
+                ArtNode4* n4 = static_cast<ArtNode4*>(node);
+                for (size_t i = 0; i < n4->num_children; ++i) {
+                    if (n4->keys[i] == byte) return &n4->children[i];
+                }
+                return nullptr;
+            }
+            case ART_NODE16: {
+                ArtNode16* n16 = static_cast<ArtNode16*>(node);
+#ifdef HAVE_SSE2
+                // сравнение со всеми 16 ключами одной инструкцией
+                __m128i needle = _mm_set1_epi8(static_cast<char>(byte));
+                __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(n16->keys));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(needle, keys)))
+                                & ((1u << n16->num_children) - 1);
+                return mask ? &n16->children[countTrailingZeros(mask)] : nullptr;
+#else
+                for (size_t i = 0; i < n16->num_children; ++i) {
+                    if (n16->keys[i] == byte) return &n16->children[i];
+                }
+                return nullptr;
+#endif
+            }
+            case ART_NODE48: {
+                ArtNode48* n48 = static_cast<ArtNode48*>(node);
+                uint8_t index = n48->child_index[byte];
+                return index ? &n48->children[index - 1] : nullptr;
+            }
+            case ART_NODE256: {
+                ArtNode256* n256 = static_cast<ArtNode256*>(node);
+                return n256->children[byte] ? &n256->children[byte] : nullptr;
+            }
+            default:
+                return nullptr;
+        }
+    }
+
+    // f(byte, child) вызывается в порядке возрастания байта; false из f прекращает перебор.
+    template<typename F>
+    static bool forEachChild(const ArtInner* node, F&& f) {
+        switch (node->type) {
+            case ART_NODE4: {
+                const ArtNode4* n4 = static_cast<const ArtNode4*>(node);
+                for (size_t i = 0; i < n4->num_children; ++i) {
+                    if (!f(n4->keys[i], n4->children[i])) return false;
+                }
+                return true;
+            }
+            case ART_NODE16: {
+                const ArtNode16* n16 = static_cast<const ArtNode16*>(node);
+                for (size_t i = 0; i < n16->num_children; ++i) {
+                    if (!f(n16->keys[i], n16->children[i])) return false;
+                }
+                return true;
+            }
+            case ART_NODE48: {
+                const ArtNode48* n48 = static_cast<const ArtNode48*>(node);
+                for (size_t byte = 0; byte < 256; ++byte) {
+                    uint8_t index = n48->child_index[byte];
+                    if (index && !f(static_cast<uint8_t>(byte), n48->children[index - 1])) return false;
+                }
+                return true;
+            }
+            case ART_NODE256: {
+                const ArtNode256* n256 = static_cast<const ArtNode256*>(node);
+                for (size_t byte = 0; byte < 256; ++byte) {
+                    if (n256->children[byte] && !f(static_cast<uint8_t>(byte), n256->children[byte])) return false;
+                }
+                return true;
+            }
+            default:
+                return true;
         }
-        v->parent = u->parent;
     }
 
-    Node* minimum(Node* node) {
-        while (node->left != NIL) {
-            node = node->left;
+    template<typename Node>
+    Node* newInner(std::string_view prefix) {
+        return std::get<ArtNodePool<Node>>(pools).allocate(prefix);
+    }
+
+    template<typename Node>
+    void deleteInner(Node* node) {
+        std::get<ArtNodePool<Node>>(pools).deallocate(node);
+    }
+
+    void deleteInner(ArtInner* node) {
+        switch (node->type) {
+            case ART_NODE4: deleteInner(static_cast<ArtNode4*>(node)); break;
+            case ART_NODE16: deleteInner(static_cast<ArtNode16*>(node)); break;
+            case ART_NODE48: deleteInner(static_cast<ArtNode48*>(node)); break;
+            case ART_NODE256: deleteInner(static_cast<ArtNode256*>(node)); break;
+            default: break;
         }
-        return node;
     }
 
-    void deleteFixup(Node* x) {
-        while (x != root && x->color == BLACK) { // x "несет" дополнительный черный цвет
-            if (x == x->parent->left) { // x - левый ребенок
-                Node* w = x->parent->right; // w - брат x
-                // случай 1: Брат w красный
-                if (w->color == RED) {
-                    w->color = BLACK;
-                    x->parent->color = RED;
-                    leftRotate(x->parent);
-                    w = x->parent->right; // новый брат w (теперь он гарантированно черный)
+    template<typename Target>
+    Target* moveHeader(ArtInner* source) {
+        Target* target = newInner<Target>(source->prefixView());
+        target->num_children = source->num_children;
+        target->terminal = source->terminal;
+        return target;
+    }
+
+    // Добавляет ребенка узлу из slot; заполненный узел заменяется следующим по размеру.
+    void addChild(ArtNode*& slot, uint8_t byte, ArtNode* child) {
+        ArtInner* node = static_cast<ArtInner*>(slot);
+        switch (node->type) {
+            case ART_NODE4: {
+                ArtNode4* n4 = static_cast<ArtNode4*>(node);
+                if (n4->num_children < 4) {
+                    size_t pos = 0;
+                    while (pos < n4->num_children && n4->keys[pos] < byte) ++pos;
+                    for (size_t i = n4->num_children; i > pos; --i) {
+                        n4->keys[i] = n4->keys[i - 1];
+                        n4->children[i] = n4->children[i - 1];
+                    }
+                    n4->keys[pos] = byte;
+                    n4->children[pos] = child;
+                    n4->num_children++;
+                    return;
                 }
-                // теперь w точно черный
-                // случай 2: брат w черный, и оба его ребенка черные
-                if (w->left->color == BLACK && w->right->color == BLACK) {
-                    w->color = RED; // "отдаем" черный цвет w родителю
-                    x = x->parent;  // перемещаем проблему (доп. черный) вверх к родителю
-                } else {
-                    // случай 3: брат w черный, левый ребенок w красный, правый черный
-                    if (w->right->color == BLACK) { // (значит, w->left->color == RED)
-                        w->left->color = BLACK;
-                        w->color = RED;
-                        rightRotate(w);
-                        w = x->parent->right; // новый брат w (для случая 4)
+                ArtNode16* grown = moveHeader<ArtNode16>(n4);
+                std::memcpy(grown->keys, n4->keys, sizeof(n4->keys));
+                std::memcpy(grown->children, n4->children, sizeof(n4->children));
+                deleteInner(n4);
+                slot = grown;
+                break;
+            }
+            case ART_NODE16: {
+                ArtNode16* n16 = static_cast<ArtNode16*>(node);
+                if (n16->num_children < 16) {
+                    size_t pos = 0;
+                    while (pos < n16->num_children && n16->keys[pos] < byte) ++pos;
+                    for (size_t i = n16->num_children; i > pos; --i) {
+                        n16->keys[i] = n16->keys[i - 1];
+                        n16->children[i] = n16->children[i - 1];
                     }
-                    // случай 4: брат w черный, и его правый ребенок красный
-                    // (w->left->color может быть любым)
-                    w->color = x->parent->color; // w наследует цвет родителя
-                    x->parent->color = BLACK;    // родитель становится черным
-                    w->right->color = BLACK;     // правый ребенок w становится черным
-                    leftRotate(x->parent);
-                    x = root; // проблема решена, завершаем цикл
+                    n16->keys[pos] = byte;
+                    n16->children[pos] = child;
+                    n16->num_children++;
+                    return;
                 }
-            } else { // x - правый ребенок (симметричные случаи)
-                Node* w = x->parent->left; // w - брат x
-                // случай 1 (симметричный)
-                if (w->color == RED) {
-                    w->color = BLACK;
-                    x->parent->color = RED;
-                    rightRotate(x->parent);
-                    w = x->parent->left;
+                ArtNode48* grown = moveHeader<ArtNode48>(n16);
+                for (size_t i = 0; i < 16; ++i) {
+                    grown->children[i] = n16->children[i];
+                    grown->child_index[n16->keys[i]] = static_cast<uint8_t>(i + 1);
                 }
-                // случай 2 (симметричный)
-                if (w->right->color == BLACK && w->left->color == BLACK) {
-                    w->color = RED;
-                    x = x->parent;
-                } else {
-                    // случай 3 (симметричный): брат w черный, правый ребенок w красный, левый черный
-                    if (w->left->color == BLACK) { // (значит, w->right->color == RED)
-                        w->right->color = BLACK;
-                        w->color = RED;
-                        leftRotate(w);
-                        w = x->parent->left;
-                    }
-                    // случай 4 (симметричный)
-                    w->color = x->parent->color;
-                    x->parent->color = BLACK;
-                    w->left->color = BLACK;
-                    rightRotate(x->parent);
-                    x = root;
+                deleteInner(n16);
+                slot = grown;
+                break;
+            }
+            case ART_NODE48: {
+                ArtNode48* n48 = static_cast<ArtNode48*>(node);
+                if (n48->num_children < 48) {
+                    size_t pos = 0;
+                    while (n48->children[pos] != nullptr) ++pos; // после удалений свободные места бывают в середине
+                    n48->children[pos] = child;
+                    n48->child_index[byte] = static_cast<uint8_t>(pos + 1);
+                    n48->num_children++;
+                    return;
                 }
+                ArtNode256* grown = moveHeader<ArtNode256>(n48);
+                for (size_t b = 0; b < 256; ++b) {
+                    if (n48->child_index[b]) grown->children[b] = n48->children[n48->child_index[b] - 1];
+                }
+                deleteInner(n48);
+                slot = grown;
+                break;
             }
+            case ART_NODE256: {
+                ArtNode256* n256 = static_cast<ArtNode256*>(node);
+                n256->children[byte] = child;
+                n256->num_children++;
+                return;
+            }
+            default:
+                return;
         }
-        x->color = BLACK; // убираем "дополнительный черный" с x (если x не NIL) или окрашиваем корень.
+        addChild(slot, byte, child);
     }
 
-    void destroyRecursive(Node* node) {
-        if (node != NIL) {
-            destroyRecursive(node->left);
-            destroyRecursive(node->right);
-            delete node;
+    // Удаляет ребенка по байту; малозаполненный узел заменяется меньшим (с запасом, чтобы не "дребезжать").
+    void removeChild(ArtNode*& slot, uint8_t byte) {
+        ArtInner* node = static_cast<ArtInner*>(slot);
+        switch (node->type) {
+            case ART_NODE4:
+            case ART_NODE16: {
+                uint8_t* keys = (node->type == ART_NODE4) ? static_cast<ArtNode4*>(node)->keys : static_cast<ArtNode16*>(node)->keys;
+                ArtNode** children = (node->type == ART_NODE4) ? static_cast<ArtNode4*>(node)->children
+                                                               : static_cast<ArtNode16*>(node)->children;
+                size_t pos = 0;
+                while (keys[pos] != byte) ++pos;
+                for (size_t i = pos + 1; i < node->num_children; ++i) {
+                    keys[i - 1] = keys[i];
+                    children[i - 1] = children[i];
+                }
+                node->num_children--;
+                children[node->num_children] = nullptr;
+                if (node->type == ART_NODE16 && node->num_children <= 3) {
+                    ArtNode16* n16 = static_cast<ArtNode16*>(node);
+                    ArtNode4* shrunk = moveHeader<ArtNode4>(n16);
+                    std::memcpy(shrunk->keys, n16->keys, n16->num_children);
+                    std::memcpy(shrunk->children, n16->children, n16->num_children * sizeof(ArtNode*));
+                    deleteInner(n16);
+                    slot = shrunk;
+                }
+                return;
+            }
+            case ART_NODE48: {
+                ArtNode48* n48 = static_cast<ArtNode48*>(node);
+                n48->children[n48->child_index[byte] - 1] = nullptr;
+                n48->child_index[byte] = 0;
+                n48->num_children--;
+                if (n48->num_children <= 12) {
+                    ArtNode16* shrunk = moveHeader<ArtNode16>(n48);
+                    size_t pos = 0;
+                    for (size_t b = 0; b < 256; ++b) {
+                        if (n48->child_index[b]) {
+                            shrunk->keys[pos] = static_cast<uint8_t>(b);
+                            shrunk->children[pos] = n48->children[n48->child_index[b] - 1];
+                            pos++;
+                        }
+                    }
+                    deleteInner(n48);
+                    slot = shrunk;
+                }
+                return;
+            }
+            case ART_NODE256: {
+                ArtNode256* n256 = static_cast<ArtNode256*>(node);
+                n256->children[byte] = nullptr;
+                n256->num_children--;
+                if (n256->num_children <= 37) {
+                    ArtNode48* shrunk = moveHeader<ArtNode48>(n256);
+                    size_t pos = 0;
+                    for (size_t b = 0; b < 256; ++b) {
+                        if (n256->children[b]) {
+                            shrunk->children[pos] = n256->children[b];
+                            shrunk->child_index[b] = static_cast<uint8_t>(pos + 1);
+                            pos++;
+                        }
+                    }
+                    deleteInner(n256);
+                    slot = shrunk;
+                }
+                return;
+            }
+            default:
+                return;
         }
     }
 
-    void inorderPrintRecursive(Node* node, std::ostream& os, bool& first_item) const {
-        if (node != NIL) {
-            inorderPrintRecursive(node->left, os, first_item);
-            if (!first_item) {
-                os << ", ";
-            }
-            os << "'" << node->key << "': " << node->value << " (" << (node->color == RED ? "R" : "B") << ")";
-            first_item = false;
-            inorderPrintRecursive(node->right, os, first_item);
+    // Удаленные листы остаются в арене до clear(): на их ключи могут указывать префиксы узлов.
+    ArtLeaf* newLeaf(std::string_view key) {
+        num_elements++;
+        char* memory = key_arena.allocate(sizeof(ArtLeaf) + key.size(), alignof(ArtLeaf));
+        ArtLeaf* leaf = new (memory) ArtLeaf(static_cast<uint32_t>(key.size()));
+        std::memcpy(memory + sizeof(ArtLeaf), key.data(), key.size());
+        return leaf;
+    }
+
+    // Кладет лист с остатком ключа rest в только что созданный узел ветвления.
+    void attachLeaf(ArtNode*& branch_slot, std::string_view rest, ArtLeaf* leaf) {
+        if (rest.empty()) {
+            static_cast<ArtInner*>(branch_slot)->terminal = leaf;
+        } else {
+            addChild(branch_slot, static_cast<uint8_t>(rest[0]), leaf);
         }
     }
 
-    bool printGivenLevel(Node* node, int level, std::ostream& os, bool first_on_level) const {
-        if (node == NIL) {
+    // После удаления: пустой узел заменяется своим terminal, узел с единственным ребенком
+    // сливается с ним (префиксы склеиваются через байт ребра). Лист хранит ключ целиком, а префикс
+    // ребенка - продолжение префикса узла в одном и том же ключе, так что новая память не нужна.
+    void compact(ArtNode*& slot) {
+        ArtInner* node = static_cast<ArtInner*>(slot);
+        if (node->num_children == 0) {
+            slot = node->terminal;
+            deleteInner(node);
+            return;
+        }
+        if (node->num_children > 1 || node->terminal) return;
+
+        uint8_t edge = 0;
+        ArtNode* child = nullptr;
+        forEachChild(node, [&edge, &child](uint8_t byte, ArtNode* c) {
+            edge = byte;
+            child = c;
             return false;
+        });
+        if (child->type != ART_LEAF) {
+            ArtInner* inner = static_cast<ArtInner*>(child);
+            size_t merged_len = node->prefix_len + 1 + inner->prefix_len;
+            inner->setPrefix(std::string_view(inner->prefix - (node->prefix_len + 1), merged_len));
         }
-        if (level == 1) {
-            if (!first_on_level) {
-                os << "  ";
-            }
-            os << "(\"" << node->key << "\":" << node->value << (node->color == RED ? " R" : " B") << ")";
+        slot = child;
+        deleteInner(node);
+    }
+
+    bool removeRecursive(ArtNode*& slot, std::string_view key, size_t depth) {
+        ArtNode* node = slot;
+        if (node == nullptr) return false;
+        if (node->type == ART_LEAF) {
+            if (static_cast<ArtLeaf*>(node)->key() != key) return false;
+            dead_bytes += sizeof(ArtLeaf) + key.size();
+            slot = nullptr;
+            num_elements--;
             return true;
-        } else if (level > 1) {
-            bool left_printed = printGivenLevel(node->left, level - 1, os, first_on_level);
-            bool right_printed = printGivenLevel(node->right, level - 1, os, first_on_level && !left_printed);
-            return left_printed || right_printed;
         }
-        return false;
+
+        ArtInner* inner = static_cast<ArtInner*>(node);
+        std::string_view prefix = inner->prefixView();
+        if (key.compare(depth, prefix.size(), prefix) != 0) return false;
+        depth += prefix.size();
+        if (depth == key.size()) {
+            if (inner->terminal == nullptr) return false;
+            dead_bytes += sizeof(ArtLeaf) + key.size();
+            inner->terminal = nullptr;
+            num_elements--;
+        } else {
+            uint8_t byte = static_cast<uint8_t>(key[depth]);
+            ArtNode** child = findChild(inner, byte);
+            if (child == nullptr || !removeRecursive(*child, key, depth + 1)) return false;
+            if (*child == nullptr) {
+                removeChild(slot, byte);
+            }
+        }
+        compact(slot);
+        return true;
     }
 
-    int getMaxDepth(Node* node) const {
-        if (node == NIL) return 0;
-        int left_depth = getMaxDepth(node->left);
-        int right_depth = getMaxDepth(node->right);
-        return std::max(left_depth, right_depth) + 1;
+    static ArtLeaf* copyLeaf(const ArtLeaf* leaf, StringArena& target) {
+        char* memory = target.allocate(sizeof(ArtLeaf) + leaf->key_len, alignof(ArtLeaf));
+        std::memcpy(memory, leaf, sizeof(ArtLeaf) + leaf->key_len);
+        return reinterpret_cast<ArtLeaf*>(memory);
     }
 
-    void printTreeRecursive(Node* node, int space_increment, int current_space, std::ostream& os) const {
-        if (node == NIL) {
-            return;
+    // Переносит листы поддерева в арену target и переставляет префиксы узлов на ключи перенесенных
+    // листов; возвращает один из листов поддерева.
+    const ArtLeaf* moveLeaves(ArtNode*& slot, size_t depth, StringArena& target) {
+        if (slot->type == ART_LEAF) {
+            ArtLeaf* leaf = copyLeaf(static_cast<ArtLeaf*>(slot), target);
+            slot = leaf;
+            return leaf;
         }
+        ArtInner* inner = static_cast<ArtInner*>(slot);
+        const ArtLeaf* any_leaf = nullptr;
+        if (inner->terminal) {
+            inner->terminal = copyLeaf(inner->terminal, target);
+            any_leaf = inner->terminal;
+        }
+        size_t child_depth = depth + inner->prefix_len + 1;
+        forEachChild(inner, [&](uint8_t byte, ArtNode*) {
+            const ArtLeaf* leaf = moveLeaves(*findChild(inner, byte), child_depth, target);
+            if (!any_leaf) any_leaf = leaf;
+            return true;
+        });
+        inner->setPrefix(any_leaf->key().substr(depth, inner->prefix_len));
+        return any_leaf;
+    }
 
-        current_space += space_increment;
-
-        printTreeRecursive(node->right, space_increment, current_space, os);
+    // Когда удаленные листы занимают больше половины арены, живые переносятся в новую:
+    // O(n), но не чаще, чем раз на n удалений.
+    void reclaimDeadLeaves() {
+        if (dead_bytes <= key_arena.bytesReserved() / 2) return;
+        StringArena target;
+        if (root) moveLeaves(root, 0, target);
+        key_arena = std::move(target);
+        dead_bytes = 0;
+    }
 
-        os << std::endl;
-        for (int i = space_increment; i < current_space; i++) {
-            os << " ";
+    // path - байты ключа до узла; visit(key, value) возвращает false, чтобы прекратить обход.
+    template<typename Visitor>
+    static bool forEachRecursive(const ArtNode* node, std::string& path, Visitor& visit) {
+        size_t path_size = path.size();
+        bool keep_going = true;
+        if (node->type == ART_LEAF) {
+            const ArtLeaf* leaf = static_cast<const ArtLeaf*>(node);
+            keep_going = visit(leaf->key(), leaf->value);
+        } else {
+            const ArtInner* inner = static_cast<const ArtInner*>(node);
+            path.append(inner->prefixView());
+            if (inner->terminal) {
+                keep_going = visit(std::string_view(path), inner->terminal->value);
+            }
+            if (keep_going) {
+                keep_going = forEachChild(inner, [&path, &visit](uint8_t byte, const ArtNode* child) {
+                    path.push_back(static_cast<char>(byte));
+                    bool result = forEachRecursive(child, path, visit);
+                    path.pop_back();
+                    return result;
+                });
+            }
         }
-        os << "(\"" << node->key << "\":" << node->value << (node->color == RED ? " R" : " B") << ")";
-
-        printTreeRecursive(node->left, space_increment, current_space, os);
+        path.resize(path_size);
+        return keep_going;
     }
 
-public:
-    RBTree() {
-        NIL = new Node("", 0, BLACK);
-        NIL->parent = NIL;
-        NIL->left = NIL;
-        NIL->right = NIL;
-        root = NIL;
+    struct NodeStatistics {
+        size_t leaves = 0, node4 = 0, node16 = 0, node48 = 0, node256 = 0, prefix_bytes = 0, max_depth = 0;
+    };
+
+    static void collectStatistics(const ArtNode* node, size_t depth, NodeStatistics& stats) {
+        stats.max_depth = std::max(stats.max_depth, depth);
+        if (node->type == ART_LEAF) {
+            stats.leaves++;
+            return;
+        }
+        const ArtInner* inner = static_cast<const ArtInner*>(node);
+        switch (inner->type) {
+            case ART_NODE4: stats.node4++; break;
+            case ART_NODE16: stats.node16++; break;
+            case ART_NODE48: stats.node48++; break;
+            case ART_NODE256: stats.node256++; break;
+            default: break;
+        }
+        stats.prefix_bytes += inner->prefix_len;
+        if (inner->terminal) stats.leaves++;
+        forEachChild(inner, [depth, &stats](uint8_t, const ArtNode* child) {
+            collectStatistics(child, depth + 1, stats);
+            return true;
+        });
     }
 
-    ~RBTree() {
-        destroyRecursive(root);
-        delete NIL;
+    static void printStructureRecursive(const ArtNode* node, std::string& path, size_t indent, std::ostream& os) {
+        os << std::string(indent * 2, ' ');
+        size_t path_size = path.size();
+        if (node->type == ART_LEAF) {
+            const ArtLeaf* leaf = static_cast<const ArtLeaf*>(node);
+            os << "'" << leaf->key() << "': " << leaf->value << std::endl;
+            return;
+        }
+        const ArtInner* inner = static_cast<const ArtInner*>(node);
+        static const char* const TYPE_NAMES[] = {"Leaf", "Node4", "Node16", "Node48", "Node256"};
+        path.append(inner->prefixView());
+        os << "[" << TYPE_NAMES[inner->type] << ", префикс " << inner->prefix_len << " байт] '" << path << "'";
+        if (inner->terminal) {
+            os << ": " << inner->terminal->value;
+        }
+        os << std::endl;
+        forEachChild(inner, [&path, indent, &os](uint8_t byte, const ArtNode* child) {
+            path.push_back(static_cast<char>(byte));
+            printStructureRecursive(child, path, indent + 1, os);
+            path.pop_back();
+            return true;
+        });
+        path.resize(path_size);
     }
 
-    RBTree(const RBTree&) = delete;
-    RBTree& operator=(const RBTree&) = delete;
+public:
+    AdaptiveRadixTree() : root(nullptr), num_elements(0), dead_bytes(0) {}
+
+    AdaptiveRadixTree(const AdaptiveRadixTree&) = delete;
+    AdaptiveRadixTree& operator=(const AdaptiveRadixTree&) = delete;
+
+    // Один спуск: возвращает счетчик ключа, при отсутствии вставляет ключ со значением 0.
+    int& findOrInsert(std::string_view key) {
+        ArtNode** slot = &root;
+        std::string_view rest = key;
+        while (true) {
+            ArtNode* node = *slot;
+            if (node == nullptr) {
+                ArtLeaf* leaf = newLeaf(key);
+                *slot = leaf;
+                return leaf->value;
+            }
 
-    void insert(const std::string& key, int value) {
-        Node* z = new Node(key, value, RED, NIL, NIL, NIL);
-        Node* y = NIL;
-        Node* x = root;
+            if (node->type == ART_LEAF) {
+                ArtLeaf* existing = static_cast<ArtLeaf*>(node);
+                std::string_view existing_rest = existing->key().substr(key.size() - rest.size());
+                if (existing_rest == rest) return existing->value;
+
+                // ленивое расширение: лист превращается в узел ветвления по первому различающемуся байту
+                size_t common = commonPrefixLength(existing_rest, rest);
+                ArtNode* branch = newInner<ArtNode4>(existing_rest.substr(0, common));
+                attachLeaf(branch, existing_rest.substr(common), existing);
+                ArtLeaf* leaf = newLeaf(key);
+                attachLeaf(branch, rest.substr(common), leaf);
+                *slot = branch;
+                return leaf->value;
+            }
 
-        while (x != NIL) {
-            y = x;
-            if (z->key < x->key) {
-                x = x->left;
-            } else if (z->key > x->key) {
-                x = x->right;
-            } else {
-                x->value = value;
-                delete z;
-                return;
+            ArtInner* inner = static_cast<ArtInner*>(node);
+            std::string_view prefix = inner->prefixView();
+            size_t matched = commonPrefixLength(prefix, rest);
+            if (matched < prefix.size()) {
+                // расхождение внутри сжатого пути: узел разрезается новым узлом ветвления
+                ArtNode* branch = newInner<ArtNode4>(prefix.substr(0, matched));
+                addChild(branch, static_cast<uint8_t>(prefix[matched]), inner);
+                inner->setPrefix(prefix.substr(matched + 1));
+                ArtLeaf* leaf = newLeaf(key);
+                attachLeaf(branch, rest.substr(matched), leaf);
+                *slot = branch;
+                return leaf->value;
             }
-        }
 
-        z->parent = y;
-        if (y == NIL) {
-            root = z;
-        } else if (z->key < y->key) {
-            y->left = z;
-        } else {
-            y->right = z;
+            rest.remove_prefix(matched);
+            if (rest.empty()) {
+                if (inner->terminal == nullptr) {
+                    inner->terminal = newLeaf(key);
+                }
+                return inner->terminal->value;
+            }
+            uint8_t byte = static_cast<uint8_t>(rest[0]);
+            ArtNode** child = findChild(inner, byte);
+            if (child == nullptr) {
+                ArtLeaf* leaf = newLeaf(key);
+                addChild(*slot, byte, leaf);
+                return leaf->value;
+            }
+            slot = child;
+            rest.remove_prefix(1);
         }
-        insertFixup(z);
     }
 
-    int* search(const std::string& key) {
-        Node* node = findNode(key);
-        return (node == NIL) ? nullptr : &node->value;
+    void insert(std::string_view key, int value) {
+        findOrInsert(key) = value;
     }
-    const int* search(const std::string& key) const {
-        Node* node = findNode(key);
-        return (node == NIL) ? nullptr : &node->value;
+
+    int* search(std::string_view key) {
+        ArtNode* node = root;
+        std::string_view rest = key;
+        while (node != nullptr) {
+            if (node->type == ART_LEAF) {
+                ArtLeaf* leaf = static_cast<ArtLeaf*>(node);
+                return (leaf->key() == key) ? &leaf->value : nullptr;
+            }
+            ArtInner* inner = static_cast<ArtInner*>(node);
+            if (rest.compare(0, inner->prefix_len, inner->prefixView()) != 0) {
+                return nullptr;
+            }
+            rest.remove_prefix(inner->prefix_len);
+            if (rest.empty()) {
+                return inner->terminal ? &inner->terminal->value : nullptr;
+            }
+            ArtNode** child = findChild(inner, static_cast<uint8_t>(rest[0]));
+            node = child ? *child : nullptr;
+            rest.remove_prefix(1);
+        }
+        return nullptr;
     }
 
-    bool remove(const std::string& key) {
-        Node* z = findNode(key);
-        if (z == NIL) return false;
+    const int* search(std::string_view key) const {
+        return const_cast<AdaptiveRadixTree*>(this)->search(key);
+    }
 
-        Node* y = z;
-        Node* x;
-        Color y_original_color = y->color;
+    bool remove(std::string_view key) {
+        if (!removeRecursive(root, key, 0)) return false;
+        reclaimDeadLeaves();
+        return true;
+    }
 
-        if (z->left == NIL) {
-            x = z->right;
-            transplant(z, z->right);
-        } else if (z->right == NIL) {
-            x = z->left;
-            transplant(z, z->left);
-        } else {
-            y = minimum(z->right);
-            y_original_color = y->color;
-            x = y->right;
-            if (y->parent == z) { // y - непосредственный потомок z
-                if (x != NIL) x->parent = y; // если x не NIL, его родителем должен стать y
-            } else {
-                transplant(y, y->right);
-                y->right = z->right;
-                y->right->parent = y;
+    // Упорядоченный обход; visit(key, value) возвращает false, чтобы прекратить обход.
+    template<typename Visitor>
+    void forEachInOrder(Visitor visit) const {
+        if (root == nullptr) return;
+        std::string path;
+        forEachRecursive(root, path, visit);
+    }
+
+    // Ключи с данным префиксом: спуск по байтам префикса, затем обход одного поддерева.
+    template<typename Visitor>
+    void forEachWithPrefix(std::string_view prefix, Visitor visit) const {
+        const ArtNode* node = root;
+        std::string_view rest = prefix;
+        while (node != nullptr) {
+            if (node->type == ART_LEAF) {
+                const ArtLeaf* leaf = static_cast<const ArtLeaf*>(node);
+                if (leaf->key().compare(0, prefix.size(), prefix) == 0) {
+                    visit(leaf->key(), leaf->value);
+                }
+                return;
             }
-            transplant(z, y);
-            y->left = z->left;
-            y->left->parent = y;
-            y->color = z->color;
+            const ArtInner* inner = static_cast<const ArtInner*>(node);
+            std::string_view node_prefix = inner->prefixView();
+            size_t compared = std::min(node_prefix.size(), rest.size());
+            if (node_prefix.compare(0, compared, rest.substr(0, compared)) != 0) return;
+            if (rest.size() <= node_prefix.size()) {
+                std::string path(prefix.substr(0, prefix.size() - rest.size()));
+                forEachRecursive(node, path, visit);
+                return;
+            }
+            rest.remove_prefix(node_prefix.size());
+            ArtNode** child = findChild(const_cast<ArtInner*>(inner), static_cast<uint8_t>(rest[0]));
+            node = child ? *child : nullptr;
+            rest.remove_prefix(1);
         }
-        delete z;
+    }
 
-        if (y_original_color == BLACK) {
-            deleteFixup(x);
-        }
-        return true;
+    size_t countWithPrefix(std::string_view prefix) const {
+        size_t count = 0;
+        forEachWithPrefix(prefix, [&count](std::string_view, int) {
+            count++;
+            return true;
+        });
+        return count;
     }
 
     void clear() {
-        destroyRecursive(root);
-        root = NIL;
+        root = nullptr;
+        num_elements = 0;
+        dead_bytes = 0;
+        std::apply([](auto&... pool) { (pool.releaseAll(), ...); }, pools);
+        key_arena.release();
+    }
+
+    size_t size() const {
+        return num_elements;
+    }
+
+    // Память блоков пулов узлов и арены с листами и ключами в байтах (как у КЧ-дерева).
+    size_t memoryUsage() const {
+        size_t pool_bytes = std::apply([](const auto&... pool) { return (pool.bytesReserved() + ...); }, pools);
+        return pool_bytes + key_arena.bytesReserved();
     }
 
     void print(std::ostream& os = std::cout) const {
         os << "{";
-        bool first = true;
-        inorderPrintRecursive(root, os, first);
+        bool first_item = true;
+        forEachInOrder([&os, &first_item](std::string_view key, int value) {
+            if (!first_item) {
+                os << ", ";
+            }
+            os << "'" << key << "': " << value;
+            first_item = false;
+            return true;
+        });
         os << "}";
     }
 
     void visualize(std::ostream& os = std::cout) const {
-        os << "Визуализация Красно-Черного Дерева:" << std::endl;
-        if (root == NIL) {
+        NodeStatistics stats;
+        if (root) collectStatistics(root, 0, stats);
+        os << "Визуализация ART (элементы: " << num_elements << ", Node4: " << stats.node4 << ", Node16: " << stats.node16
+           << ", Node48: " << stats.node48 << ", Node256: " << stats.node256 << ", глубина: " << stats.max_depth
+           << ", байт в сжатых путях: " << stats.prefix_bytes << ", память: " << memoryUsage() << " байт):" << std::endl;
+        if (root == nullptr) {
             os << "<дерево пусто>" << std::endl;
             return;
         }
-
-        const int SPACE_INCREMENT = 15;
-        printTreeRecursive(root, SPACE_INCREMENT, 0, os);
-        os << std::endl << std::endl << "Конец визуализации." << std::endl;
+        std::string path;
+        printStructureRecursive(root, path, 0, os);
     }
 };
 
-
 class Dictionary {
 private:
-    RBTree rbt;
-    /*std::string toLowerASCII(std::string s) const {
-        std::transform(s.begin(), s.end(), s.begin(),
-                       [](unsigned char c){ return std::tolower(c); });
-        return s;
-    }*/
-    std::string normalizeWord(const std::string& s) const {
-        return ::normalizeWordToLower(s);
-    }
+    AdaptiveRadixTree tree;
 
 public:
     Dictionary() = default;
 
-    void addWord(const std::string& word_raw) {
+    void addWord(std::string_view word_raw) {
         if (word_raw.empty()) return;
-        //std::string word = toLowerASCII(word_raw);
-        std::string word = normalizeWord(word_raw);
-
-        int* current_val_ptr = rbt.search(word);
-        if (current_val_ptr) {
-            rbt.insert(word, (*current_val_ptr) + 1);
-        } else {
-            rbt.insert(word, 1);
-        }
+        NormalizedKey key(word_raw);
+        tree.findOrInsert(key.view())++;
     }
 
-    void removeWord(const std::string& word_raw) {
+    void removeWord(std::string_view word_raw) {
         if (word_raw.empty()) return;
-        //std::string word = toLowerASCII(word_raw);
-        std::string word = normalizeWord(word_raw);
-        rbt.remove(word);
+        NormalizedKey key(word_raw);
+        tree.remove(key.view());
     }
 
-    bool findWord(const std::string& word_raw) const {
+    bool findWord(std::string_view word_raw) const {
         if (word_raw.empty()) return false;
-        //std::string word = toLowerASCII(word_raw);
-        std::string word = normalizeWord(word_raw);
+        NormalizedKey key(word_raw);
+        std::string_view word = key.view();
 
-        const int* count_ptr = rbt.search(word);
+        const int* count_ptr = tree.search(word);
         if (count_ptr) {
             std::cout << "Слово '" << word_raw << "' (ключ: '" << word << "') найдено, частота: " << *count_ptr << std::endl;
             return true;
@@ -740,8 +4581,8 @@ public:
     }
 
     void clear() {
-        rbt.clear();
-        std::cout << "Словарь (КЧ-дерево) очищен." << std::endl;
+        tree.clear();
+        std::cout << "Словарь (ART) очищен." << std::endl;
     }
 
     void loadFromFile(const std::string& filepath, bool append = false) {
@@ -749,23 +4590,51 @@ public:
             clear();
         }
         try {
-            std::string content = readFileToString(filepath);
-            std::vector<std::string> words = processTextToWords(content);
-            for (const std::string& word : words) {
-                 if (!word.empty()) addWord(word);
+            forEachWordInFile(filepath, [this](std::string_view word) { addWord(word); });
+            std::cout << "Словарь загружен/дополнен из файла '" << filepath << "' (ART)." << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Ошибка при загрузке из файла (ART): " << e.what() << std::endl;
+        }
+    }
+
+    void loadFromFiles(const std::vector<std::string>& filepaths, bool append = false, size_t num_threads = 0) {
+        if (!append) {
+            clear();
+        }
+        try {
+            std::vector<DictionaryWithHashTable::HashTable> counts = DictionaryWithHashTable::countWordsInFilesParallel(filepaths, num_threads);
+            for (const auto& part : counts) {
+                part.forEach([this](const DictionaryWithHashTable::HashNode& node) { tree.findOrInsert(node.key) += node.value; });
             }
-            std::cout << "Словарь загружен/дополнен из файла '" << filepath << "' (КЧ-дерево)." << std::endl;
+            std::cout << "Словарь загружен/дополнен из " << filepaths.size() << " файлов (ART, параллельно)." << std::endl;
         } catch (const std::runtime_error& e) {
-            std::cerr << "Ошибка при загрузке из файла (КЧ-дерево): " << e.what() << std::endl;
+            std::cerr << "Ошибка при загрузке из файлов (ART): " << e.what() << std::endl;
         }
     }
 
+    // Слова с заданным префиксом (автодополнение), не более limit штук.
+    std::vector<std::pair<std::string, int>> wordsWithPrefix(std::string_view prefix_raw, size_t limit = SIZE_MAX) const {
+        NormalizedKey prefix(prefix_raw);
+        std::vector<std::pair<std::string, int>> result;
+        if (limit == 0) return result;
+        tree.forEachWithPrefix(prefix.view(), [&result, limit](std::string_view key, int value) {
+            result.emplace_back(std::string(key), value);
+            return result.size() < limit;
+        });
+        return result;
+    }
+
+    size_t countWordsWithPrefix(std::string_view prefix_raw) const {
+        NormalizedKey prefix(prefix_raw);
+        return tree.countWithPrefix(prefix.view());
+    }
+
     void print(std::ostream& os = std::cout) const {
-        rbt.print(os);
+        tree.print(os);
     }
 
     void visualizeStructure(std::ostream& os = std::cout) const {
-        rbt.visualize(os);
+        tree.visualize(os);
     }
 };
 
@@ -895,179 +4764,979 @@ std::string generateRandomText(size_t approx_target_chars, const std::string& fi
     weighted_chars.push_back({"-", punct_weight});
     weighted_chars.push_back({":", punct_weight});
 
-    std::vector<std::string> char_pool;
-    std::vector<double> weights;
-    for (const auto& p : weighted_chars) {
-        char_pool.push_back(p.first);
-        weights.push_back(p.second);
+    std::vector<std::string> char_pool;
+    std::vector<double> weights;
+    for (const auto& p : weighted_chars) {
+        char_pool.push_back(p.first);
+        weights.push_back(p.second);
+    }
+
+    std::random_device rd;
+    std::mt19937 rng(rd());
+
+    std::discrete_distribution<size_t> char_dist(weights.begin(), weights.end());
+
+    std::uniform_real_distribution<double> run_probability_dist(0.0, 1.0);
+    double probability_of_run = 0.20;
+    std::uniform_int_distribution<size_t> run_length_dist(3, 10);
+
+    std::string result_text;
+    result_text.reserve(approx_target_chars * 2);
+
+    size_t current_char_count = 0;
+
+    while (current_char_count < approx_target_chars) {
+        size_t char_idx = char_dist(rng);
+        const std::string& selected_char_utf8 = char_pool[char_idx];
+
+        if (run_probability_dist(rng) < probability_of_run && (current_char_count + 3 < approx_target_chars) ) {
+            size_t length_of_run = run_length_dist(rng);
+            length_of_run = std::min(length_of_run, approx_target_chars - current_char_count);
+            if (length_of_run < 3 && current_char_count + length_of_run < approx_target_chars) {
+                 result_text += selected_char_utf8;
+                 current_char_count++;
+            } else if (length_of_run >=3 ){
+                for (size_t k = 0; k < length_of_run; ++k) {
+                    result_text += selected_char_utf8;
+                }
+                current_char_count += length_of_run;
+            } else {
+                 result_text += selected_char_utf8;
+                 current_char_count++;
+            }
+        } else {
+            result_text += selected_char_utf8;
+            current_char_count++;
+        }
+    }
+
+    std::ofstream outfile(filename, std::ios::binary);
+    if (outfile.is_open()) {
+        outfile.write(result_text.data(), result_text.length());
+        outfile.close();
+        std::cout << "Сгенерирован файл '" << filename << "' (сгенерировано " << current_char_count
+                  << " UTF-8 симв., размер файла " << result_text.length() << " байт)." << std::endl;
+    } else {
+        std::cerr << "Не удалось создать файл для генерации: " << filename << std::endl;
+    }
+    return result_text;
+}*/
+
+static_assert(MIN_RUN_LENGTH == 3, "поиск серий ниже сравнивает тройки соседних байтов");
+
+// Первая позиция p >= from, с которой начинаются MIN_RUN_LENGTH одинаковых байтов; n, если таких нет.
+inline size_t findRunStart(const char* data, size_t from, size_t n) {
+#ifdef HAVE_SSE2
+    for (; from + 18 <= n; from += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + from));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + from + 1));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + from + 2));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, b), _mm_cmpeq_epi8(b, c))));
+        if (mask != 0) return from + lowestSetBit(mask);
+    }
+#endif
+    for (; from + 2 < n; ++from) {
+        if (data[from] == data[from + 1] && data[from + 1] == data[from + 2]) return from;
+    }
+    return n;
+}
+
+// Конец серии байта data[from]: первая позиция p > from с другим байтом либо n.
+inline size_t findRunEnd(const char* data, size_t from, size_t n) {
+    const char value = data[from];
+    size_t pos = from + 1;
+#ifdef HAVE_SSE2
+    const __m128i pattern = _mm_set1_epi8(value);
+    for (; pos + 16 <= n; pos += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        uint32_t differs = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, pattern))) ^ 0xFFFFu;
+        if (differs != 0) return pos + lowestSetBit(differs);
+    }
+#endif
+    while (pos < n && data[pos] == value) pos++;
+    return pos;
+}
+
+// Верхняя граница размера результата advancedRleEncode. Серия из N >= 3 байт занимает не больше N байт,
+// литерал из L байт - L + 2 + digits(L) и следует за серией, поэтому результат не больше 2n + 2.
+constexpr size_t advancedRleEncodedBound(size_t input_size) {
+    return 2 * input_size + 2;
+}
+
+// Кодирует input в out (не меньше advancedRleEncodedBound(input.size()) байт) за один проход, возвращает длину.
+// Формат: "N#c" - серия из N >= MIN_RUN_LENGTH байтов c, "-L#<L байт>" - литерал из байтов между сериями.
+// Разбор input на сегменты RLE по порядку: on_literal(offset, length) - байты между сериями,
+// on_run(value, length) - серия из length >= MIN_RUN_LENGTH байтов value.
+template<typename LiteralSink, typename RunSink>
+void forEachRleSegment(std::string_view input, LiteralSink&& on_literal, RunSink&& on_run) {
+    const char* data = input.data();
+    const size_t n = input.length();
+    size_t i = 0;
+    while (i < n) {
+        size_t run_start = findRunStart(data, i, n);
+        if (run_start > i) {
+            on_literal(i, run_start - i);
+            i = run_start;
+        }
+        if (i < n) {
+            size_t run_end = findRunEnd(data, i, n);
+            on_run(data[i], run_end - i);
+            i = run_end;
+        }
+    }
+}
+
+size_t advancedRleEncodeInto(std::string_view input, char* out) {
+    const char SEPARATOR = '#';
+    char* write = out;
+    forEachRleSegment(input, [&](size_t offset, size_t length) {
+        *write++ = '-';
+        write = std::to_chars(write, write + 20, length).ptr;
+        *write++ = SEPARATOR;
+        std::memcpy(write, input.data() + offset, length);
+        write += length;
+    }, [&](char value, size_t length) {
+        write = std::to_chars(write, write + 20, length).ptr;
+        *write++ = SEPARATOR;
+        *write++ = value;
+    });
+    return static_cast<size_t>(write - out);
+}
+
+std::string advancedRleEncode(std::string_view input) {
+    if (input.empty()) return "";
+    // буфер не инициализируется: страницы под неиспользованный запас границы не затрагиваются
+    std::unique_ptr<char[]> buffer(new char[advancedRleEncodedBound(input.size())]);
+    size_t encoded_size = advancedRleEncodeInto(input, buffer.get());
+    return std::string(buffer.get(), encoded_size);
+}
+
+// Предел результата, декодируемого целиком в std::string; большие данные - через StreamingRleDecoder
+// или *DecodeInto в буфер вызывающего.
+constexpr size_t MAX_IN_MEMORY_DECODED_SIZE =
+    static_cast<size_t>(std::min<uint64_t>(uint64_t(1) << 32, SIZE_MAX / 2));
+
+// Сумма длин токенов с проверкой: результат больше limit (в том числе переполнение size_t) - std::runtime_error.
+inline void addDecodedLength(size_t& total, size_t length, size_t limit) {
+    if (length > limit - total) {
+        throw std::runtime_error("RLE Decode: Decoded data exceeds " + std::to_string(limit) + " bytes.");
+    }
+    total += length;
+}
+
+// Разбор текстового RLE по токенам: on_literal(data, length) для "-L#<L байт>", on_run(value, length) для "N#c".
+// Некорректный ввод - std::runtime_error.
+template<typename LiteralSink, typename RunSink>
+void forEachTextRleToken(std::string_view encoded, LiteralSink&& on_literal, RunSink&& on_run) {
+    const char SEPARATOR = '#';
+    const char* begin = encoded.data();
+    const char* end = begin + encoded.size();
+    const char* p = begin;
+
+    while (p < end) {
+        bool is_literal = *p == '-';
+        if (is_literal) {
+            p++;
+            if (p >= end || !std::isdigit(static_cast<unsigned char>(*p))) {
+                throw std::runtime_error("RLE Decode: '-' not followed by a digit or EOF.");
+            }
+        } else if (!std::isdigit(static_cast<unsigned char>(*p))) {
+            throw std::runtime_error("RLE Decode: Sequence does not start with '-' or digit. Found: '" + std::string(1, *p) + "' at position " + std::to_string(p - begin));
+        }
+
+        size_t length = 0;
+        auto [number_end, ec] = std::from_chars(p, end, length);
+        if (ec == std::errc::result_out_of_range) {
+            throw std::runtime_error("RLE Decode: Number '" + std::string(p, number_end) + "' out of range.");
+        }
+        p = number_end;
+        if (p >= end || *p != SEPARATOR) {
+            throw std::runtime_error("RLE Decode: Missing separator '" + std::string(1, SEPARATOR) + "' after number at pos ~" + std::to_string(p - begin));
+        }
+        p++;
+        if (length == 0) {
+            throw std::runtime_error("RLE Decode: Invalid count/length (<=0): 0");
+        }
+
+        if (is_literal) {
+            if (length > static_cast<size_t>(end - p)) {
+                throw std::runtime_error("RLE Decode: Not enough data for literal sequence. Expected " + std::to_string(length) + ", available " + std::to_string(end - p));
+            }
+            on_literal(p, length);
+            p += length;
+        } else {
+            if (p >= end) {
+                throw std::runtime_error("RLE Decode: Missing char_to_repeat after count and separator.");
+            }
+            on_run(*p, length);
+            p++;
+        }
+    }
+}
+
+// Точный размер результата декодирования: проход только по заголовкам токенов, литералы пропускаются.
+// Размер больше limit - std::runtime_error.
+size_t advancedRleDecodedSize(std::string_view encoded, size_t limit = SIZE_MAX) {
+    size_t total = 0;
+    forEachTextRleToken(encoded, [&total, limit](const char*, size_t length) { addDecodedLength(total, length, limit); },
+                        [&total, limit](char, size_t length) { addDecodedLength(total, length, limit); });
+    return total;
+}
+
+// Декодирует в out (capacity байт, обычно advancedRleDecodedSize) без промежуточных выделений памяти:
+// серии заполняются memset, литералы копируются memcpy. Возвращает число записанных байт.
+size_t advancedRleDecodeInto(std::string_view encoded, char* out, size_t capacity) {
+    size_t written = 0;
+    auto reserve = [&](size_t length) {
+        if (length > capacity - written) {
+            throw std::runtime_error("RLE Decode: Output buffer too small (" + std::to_string(capacity) + " bytes).");
+        }
+    };
+    forEachTextRleToken(encoded, [&](const char* data, size_t length) {
+        reserve(length);
+        std::memcpy(out + written, data, length);
+        written += length;
+    }, [&](char value, size_t length) {
+        reserve(length);
+        std::memset(out + written, static_cast<unsigned char>(value), length);
+        written += length;
+    });
+    return written;
+}
+
+std::string advancedRleDecode(std::string_view encoded_input) {
+    std::string decoded(advancedRleDecodedSize(encoded_input, MAX_IN_MEMORY_DECODED_SIZE), '\0');
+    advancedRleDecodeInto(encoded_input, &decoded[0], decoded.size());
+    return decoded;
+}
+
+// Двоичный формат RLE. Заголовок: "RLEB", версия формата (1 байт), исходный размер (u64 little-endian,
+// UNKNOWN_ORIGINAL_SIZE - не известен заранее). Далее токены: varint(length << 1 | tag),
+// tag 1 - серия, за ней один байт значения; tag 0 - литерал, за ним length байт.
+// Длины - LEB128: 7 бит на байт, старший бит - признак продолжения.
+const char BINARY_MAGIC[4] = {'R', 'L', 'E', 'B'};
+const uint8_t BINARY_FORMAT_VERSION = 1;
+const size_t BINARY_HEADER_SIZE = sizeof(BINARY_MAGIC) + 1 + 8;
+const uint64_t UNKNOWN_ORIGINAL_SIZE = UINT64_MAX;
+const size_t MAX_VARINT_BYTES = 10;
+
+enum class RleFormat { Text, Binary, Block };
+
+inline char* writeVarint(char* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<char>(value);
+    return out;
+}
+
+// Читает varint с позиции pos и сдвигает pos; false, если данные оборвались или значение длиннее 64 бит.
+inline bool readVarint(std::string_view data, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(data[pos++]);
+        if (shift == 63 && byte > 1) return false; // в десятом байте помещается только младший бит
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+inline void writeU64(char* out, uint64_t value) {
+    for (size_t i = 0; i < 8; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+inline uint64_t readU64(const char* data) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+inline void writeBinaryHeader(char* out, uint64_t original_size) {
+    std::memcpy(out, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    out[sizeof(BINARY_MAGIC)] = static_cast<char>(BINARY_FORMAT_VERSION);
+    writeU64(out + sizeof(BINARY_MAGIC) + 1, original_size);
+}
+
+inline bool hasBinaryHeader(std::string_view encoded) {
+    return encoded.size() >= sizeof(BINARY_MAGIC) && std::memcmp(encoded.data(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
+
+// Проверяет заголовок и возвращает исходный размер из него.
+uint64_t readBinaryHeader(std::string_view encoded) {
+    if (encoded.size() < BINARY_HEADER_SIZE || !hasBinaryHeader(encoded)) {
+        throw std::runtime_error("RLE Decode: Missing binary RLE header.");
+    }
+    uint8_t version = static_cast<uint8_t>(encoded[sizeof(BINARY_MAGIC)]);
+    if (version != BINARY_FORMAT_VERSION) {
+        throw std::runtime_error("RLE Decode: Unsupported binary RLE format version " + std::to_string(version) + ".");
+    }
+    return readU64(encoded.data() + sizeof(BINARY_MAGIC) + 1);
+}
+
+// Размер из заголовка не принимается на веру: он должен совпасть с суммой длин токенов.
+inline void checkBinaryHeaderSize(uint64_t original_size, uint64_t decoded_size) {
+    if (original_size != UNKNOWN_ORIGINAL_SIZE && decoded_size != original_size) {
+        throw std::runtime_error("RLE Decode: Decoded size " + std::to_string(decoded_size) + " does not match header size "
+                                 + std::to_string(original_size) + ".");
+    }
+}
+
+// Верхняя граница binaryRleEncode. Серия из N >= 3 байт занимает не больше N - 1 байт, и этот байт
+// покрывает однобайтовую длину следующего литерала; каждый следующий байт длины требует литерала
+// не короче 64 байт. Запас MAX_VARINT_BYTES - на литерал в начале входа.
+constexpr size_t binaryRleEncodedBound(size_t input_size) {
+    return BINARY_HEADER_SIZE + input_size + input_size / 64 + MAX_VARINT_BYTES;
+}
+
+// Токены двоичного RLE без заголовка; out - не меньше binaryRleEncodedBound(input.size()) - BINARY_HEADER_SIZE байт.
+size_t binaryRleEncodeTokensInto(std::string_view input, char* out) {
+    char* write = out;
+    forEachRleSegment(input, [&](size_t offset, size_t length) {
+        write = writeVarint(write, static_cast<uint64_t>(length) << 1);
+        std::memcpy(write, input.data() + offset, length);
+        write += length;
+    }, [&](char value, size_t length) {
+        write = writeVarint(write, (static_cast<uint64_t>(length) << 1) | 1);
+        *write++ = value;
+    });
+    return static_cast<size_t>(write - out);
+}
+
+size_t binaryRleEncodeInto(std::string_view input, char* out) {
+    writeBinaryHeader(out, input.size());
+    return BINARY_HEADER_SIZE + binaryRleEncodeTokensInto(input, out + BINARY_HEADER_SIZE);
+}
+
+std::string binaryRleEncode(std::string_view input) {
+    std::unique_ptr<char[]> buffer(new char[binaryRleEncodedBound(input.size())]);
+    size_t encoded_size = binaryRleEncodeInto(input, buffer.get());
+    return std::string(buffer.get(), encoded_size);
+}
+
+// Разбор потока токенов двоичного RLE (данные после заголовка).
+template<typename LiteralSink, typename RunSink>
+void forEachBinaryRleToken(std::string_view encoded, LiteralSink&& on_literal, RunSink&& on_run) {
+    size_t pos = 0;
+    while (pos < encoded.size()) {
+        uint64_t token = 0;
+        if (!readVarint(encoded, pos, token)) {
+            throw std::runtime_error("RLE Decode: Truncated or overlong length at position " + std::to_string(pos) + ".");
+        }
+        uint64_t length = token >> 1;
+        if (length == 0) {
+            throw std::runtime_error("RLE Decode: Zero-length token at position " + std::to_string(pos) + ".");
+        }
+        if (token & 1) {
+            if (pos >= encoded.size()) {
+                throw std::runtime_error("RLE Decode: Missing run value after length.");
+            }
+            on_run(encoded[pos++], static_cast<size_t>(length));
+        } else {
+            if (length > encoded.size() - pos) {
+                throw std::runtime_error("RLE Decode: Not enough data for literal sequence. Expected " + std::to_string(length) + ", available " + std::to_string(encoded.size() - pos));
+            }
+            on_literal(encoded.data() + pos, static_cast<size_t>(length));
+            pos += static_cast<size_t>(length);
+        }
+    }
+}
+
+// Размер результата считается проходом по токенам (литералы пропускаются) и сверяется с заголовком,
+// так что поврежденный заголовок не задает размер буфера. Размер больше limit - std::runtime_error.
+size_t binaryRleDecodedSize(std::string_view encoded, size_t limit = SIZE_MAX) {
+    uint64_t original_size = readBinaryHeader(encoded);
+    size_t total = 0;
+    forEachBinaryRleToken(encoded.substr(BINARY_HEADER_SIZE),
+                          [&total, limit](const char*, size_t length) { addDecodedLength(total, length, limit); },
+                          [&total, limit](char, size_t length) { addDecodedLength(total, length, limit); });
+    checkBinaryHeaderSize(original_size, total);
+    return total;
+}
+
+// Декодирует поток токенов без заголовка в out (capacity байт); возвращает число записанных байт.
+size_t binaryRleDecodeTokensInto(std::string_view tokens, char* out, size_t capacity) {
+    size_t written = 0;
+    auto reserve = [&](size_t length) {
+        if (length > capacity - written) {
+            throw std::runtime_error("RLE Decode: Output buffer too small (" + std::to_string(capacity) + " bytes).");
+        }
+    };
+    forEachBinaryRleToken(tokens, [&](const char* data, size_t length) {
+        reserve(length);
+        std::memcpy(out + written, data, length);
+        written += length;
+    }, [&](char value, size_t length) {
+        reserve(length);
+        std::memset(out + written, static_cast<unsigned char>(value), length);
+        written += length;
+    });
+    return written;
+}
+
+size_t binaryRleDecodeInto(std::string_view encoded, char* out, size_t capacity) {
+    uint64_t original_size = readBinaryHeader(encoded);
+    size_t written = binaryRleDecodeTokensInto(encoded.substr(BINARY_HEADER_SIZE), out, capacity);
+    checkBinaryHeaderSize(original_size, written);
+    return written;
+}
+
+std::string binaryRleDecode(std::string_view encoded) {
+    // размер сверен с токенами до выделения памяти; токены серий могут честно описывать огромный
+    // результат, поэтому он ограничен MAX_IN_MEMORY_DECODED_SIZE
+    std::string decoded(binaryRleDecodedSize(encoded, MAX_IN_MEMORY_DECODED_SIZE), '\0');
+    binaryRleDecodeInto(encoded, &decoded[0], decoded.size());
+    return decoded;
+}
+
+// Байты [skip, skip + length) результата декодирования потока токенов - в out; возвращает число записанных байт.
+// decoded_size - полный размер результата (из индекса блоков): токен, выходящий за него, считается ошибкой.
+size_t binaryRleDecodeTokensWindow(std::string_view tokens, uint64_t decoded_size, uint64_t skip, char* out, size_t length) {
+    uint64_t position = 0;
+    size_t written = 0;
+    auto window = [&](size_t token_length) {
+        if (token_length > decoded_size - position) {
+            throw std::runtime_error("RLE Decode: Token at decoded offset " + std::to_string(position) + " exceeds block size " + std::to_string(decoded_size) + ".");
+        }
+        uint64_t token_end = position + token_length;
+        uint64_t from = std::max(position, skip);
+        uint64_t to = std::min<uint64_t>(token_end, skip + length);
+        uint64_t token_offset = from - position;
+        position = token_end;
+        return std::make_pair(static_cast<size_t>(token_offset), from < to ? static_cast<size_t>(to - from) : 0);
+    };
+    auto reserve = [&](size_t count) {
+        if (count > length - written) {
+            throw std::runtime_error("RLE Decode: Output buffer too small (" + std::to_string(length) + " bytes).");
+        }
+    };
+    forEachBinaryRleToken(tokens, [&](const char* data, size_t token_length) {
+        auto [token_offset, count] = window(token_length);
+        if (count == 0) return;
+        reserve(count);
+        std::memcpy(out + written, data + token_offset, count);
+        written += count;
+    }, [&](char value, size_t token_length) {
+        size_t count = window(token_length).second;
+        if (count == 0) return;
+        reserve(count);
+        std::memset(out + written, static_cast<unsigned char>(value), count);
+        written += count;
+    });
+    return written;
+}
+
+// Блочный контейнер RLE: вход делится на независимые блоки, которые кодируются и декодируются параллельно.
+// Заголовок: "RLEI", версия (1 байт), исходный размер, размер блока и число блоков (u64 little-endian).
+// Индекс: для каждого блока смещение его токенов от конца индекса и исходный размер блока (u64).
+// Блок - поток токенов двоичного RLE без собственного заголовка.
+const char BLOCK_MAGIC[4] = {'R', 'L', 'E', 'I'};
+const uint8_t BLOCK_FORMAT_VERSION = 1;
+const size_t BLOCK_HEADER_SIZE = sizeof(BLOCK_MAGIC) + 1 + 3 * 8;
+const size_t BLOCK_INDEX_ENTRY_SIZE = 2 * 8;
+const size_t DEFAULT_RLE_BLOCK_SIZE = 1024 * 1024;
+
+inline bool hasBlockHeader(std::string_view encoded) {
+    return encoded.size() >= sizeof(BLOCK_MAGIC) && std::memcmp(encoded.data(), BLOCK_MAGIC, sizeof(BLOCK_MAGIC)) == 0;
+}
+
+// Кодирует блоки на num_threads потоках (0 - по числу ядер).
+std::string blockRleEncode(std::string_view input, size_t block_size = DEFAULT_RLE_BLOCK_SIZE, size_t num_threads = 0) {
+    if (block_size == 0) {
+        throw std::runtime_error("RLE: Block size must be positive.");
+    }
+    if (num_threads == 0) num_threads = defaultThreadCount();
+    size_t num_blocks = input.size() / block_size + (input.size() % block_size != 0);
+
+    std::vector<std::unique_ptr<char[]>> block_tokens(num_blocks);
+    std::vector<size_t> block_encoded_size(num_blocks);
+    runParallel(num_blocks, num_threads, [&](size_t b) {
+        std::string_view block = input.substr(b * block_size, block_size);
+        block_tokens[b].reset(new char[binaryRleEncodedBound(block.size())]);
+        block_encoded_size[b] = binaryRleEncodeTokensInto(block, block_tokens[b].get());
+    });
+
+    size_t data_start = BLOCK_HEADER_SIZE + num_blocks * BLOCK_INDEX_ENTRY_SIZE;
+    std::vector<size_t> block_offset(num_blocks);
+    size_t data_size = 0;
+    for (size_t b = 0; b < num_blocks; ++b) {
+        block_offset[b] = data_size;
+        data_size += block_encoded_size[b];
+    }
+
+    std::string encoded(data_start + data_size, '\0');
+    std::memcpy(&encoded[0], BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+    encoded[sizeof(BLOCK_MAGIC)] = static_cast<char>(BLOCK_FORMAT_VERSION);
+    writeU64(&encoded[sizeof(BLOCK_MAGIC) + 1], input.size());
+    writeU64(&encoded[sizeof(BLOCK_MAGIC) + 9], block_size);
+    writeU64(&encoded[sizeof(BLOCK_MAGIC) + 17], num_blocks);
+    for (size_t b = 0; b < num_blocks; ++b) {
+        char* entry = &encoded[BLOCK_HEADER_SIZE + b * BLOCK_INDEX_ENTRY_SIZE];
+        writeU64(entry, block_offset[b]);
+        writeU64(entry + 8, std::min(block_size, input.size() - b * block_size));
+    }
+    runParallel(num_blocks, num_threads, [&](size_t b) {
+        std::memcpy(&encoded[data_start + block_offset[b]], block_tokens[b].get(), block_encoded_size[b]);
+        block_tokens[b].reset();
+    });
+    return encoded;
+}
+
+// Чтение блочного контейнера: заголовок и индекс проверяются в конструкторе, после чего любой диапазон
+// исходных байтов восстанавливается декодированием только пересекающих его блоков.
+class BlockRleReader {
+private:
+    std::string_view data;                      // токены всех блоков
+    uint64_t original_size;
+    uint64_t block_size;                        // все блоки, кроме последнего, ровно такого размера
+    std::vector<uint64_t> compressed_offsets;   // num_blocks + 1 значений, последнее - размер data
+    std::vector<uint64_t> uncompressed_offsets; // num_blocks + 1 значений, последнее - original_size
+
+    std::string_view blockTokens(size_t block) const {
+        return data.substr(compressed_offsets[block], compressed_offsets[block + 1] - compressed_offsets[block]);
+    }
+
+public:
+    explicit BlockRleReader(std::string_view encoded) : original_size(0), block_size(0) {
+        if (encoded.size() < BLOCK_HEADER_SIZE || !hasBlockHeader(encoded)) {
+            throw std::runtime_error("RLE Decode: Missing block RLE header.");
+        }
+        uint8_t version = static_cast<uint8_t>(encoded[sizeof(BLOCK_MAGIC)]);
+        if (version != BLOCK_FORMAT_VERSION) {
+            throw std::runtime_error("RLE Decode: Unsupported block RLE format version " + std::to_string(version) + ".");
+        }
+        original_size = readU64(encoded.data() + sizeof(BLOCK_MAGIC) + 1);
+        block_size = readU64(encoded.data() + sizeof(BLOCK_MAGIC) + 9);
+        uint64_t num_blocks = readU64(encoded.data() + sizeof(BLOCK_MAGIC) + 17);
+        if (block_size == 0) {
+            throw std::runtime_error("RLE Decode: Block size in the header is zero.");
+        }
+        if (num_blocks > (encoded.size() - BLOCK_HEADER_SIZE) / BLOCK_INDEX_ENTRY_SIZE) {
+            throw std::runtime_error("RLE Decode: Block index is truncated.");
+        }
+        size_t data_start = BLOCK_HEADER_SIZE + static_cast<size_t>(num_blocks) * BLOCK_INDEX_ENTRY_SIZE;
+        data = encoded.substr(data_start);
+
+        compressed_offsets.reserve(num_blocks + 1);
+        uncompressed_offsets.reserve(num_blocks + 1);
+        uint64_t uncompressed_total = 0;
+        for (size_t b = 0; b < num_blocks; ++b) {
+            const char* entry = encoded.data() + BLOCK_HEADER_SIZE + b * BLOCK_INDEX_ENTRY_SIZE;
+            uint64_t offset = readU64(entry);
+            uint64_t block_uncompressed = readU64(entry + 8);
+            // блоки идут подряд с начала области данных, каждый (кроме последнего) - ровно block_size байт
+            if (offset > data.size() || (b == 0 && offset != 0) || (b > 0 && offset < compressed_offsets.back())
+                || block_uncompressed == 0 || block_uncompressed != std::min(block_size, original_size - uncompressed_total)) {
+                throw std::runtime_error("RLE Decode: Corrupted block index entry " + std::to_string(b) + ".");
+            }
+            compressed_offsets.push_back(offset);
+            uncompressed_offsets.push_back(uncompressed_total);
+            uncompressed_total += block_uncompressed;
+        }
+        if (uncompressed_total != original_size) {
+            throw std::runtime_error("RLE Decode: Block sizes do not add up to the original size.");
+        }
+        compressed_offsets.push_back(data.size());
+        uncompressed_offsets.push_back(uncompressed_total);
+    }
+
+    uint64_t originalSize() const {
+        return original_size;
+    }
+
+    size_t blockCount() const {
+        return compressed_offsets.size() - 1;
+    }
+
+    // Байты [offset, offset + length) исходных данных в out; блоки декодируются на num_threads потоках (0 - по числу ядер).
+    void decodeRangeInto(uint64_t offset, size_t length, char* out, size_t num_threads = 0) const {
+        if (offset > original_size || length > original_size - offset) {
+            throw std::runtime_error("RLE Decode: Range [" + std::to_string(offset) + ", +" + std::to_string(length)
+                                     + ") is outside of " + std::to_string(original_size) + " bytes.");
+        }
+        if (length == 0) return;
+        if (num_threads == 0) num_threads = defaultThreadCount();
+        uint64_t range_end = offset + length;
+        size_t first = static_cast<size_t>(offset / block_size);
+        size_t last = static_cast<size_t>((range_end - 1) / block_size);
+
+        runParallel(last - first + 1, num_threads, [&](size_t i) {
+            size_t block = first + i;
+            uint64_t block_begin = uncompressed_offsets[block];
+            uint64_t block_end = uncompressed_offsets[block + 1];
+            uint64_t from = std::max(offset, block_begin);
+            uint64_t to = std::min(range_end, block_end);
+            size_t expected = static_cast<size_t>(to - from);
+            char* dest = out + (from - offset);
+            size_t written = (from == block_begin && to == block_end)
+                ? binaryRleDecodeTokensInto(blockTokens(block), dest, expected)
+                : binaryRleDecodeTokensWindow(blockTokens(block), block_end - block_begin, from - block_begin, dest, expected);
+            if (written != expected) {
+                throw std::runtime_error("RLE Decode: Block " + std::to_string(block) + " is shorter than its index entry.");
+            }
+        });
+    }
+
+    std::string decodeRange(uint64_t offset, size_t length, size_t num_threads = 0) const {
+        if (offset > original_size || length > original_size - offset) {
+            throw std::runtime_error("RLE Decode: Range [" + std::to_string(offset) + ", +" + std::to_string(length)
+                                     + ") is outside of " + std::to_string(original_size) + " bytes.");
+        }
+        if (length > MAX_IN_MEMORY_DECODED_SIZE) {
+            throw std::runtime_error("RLE Decode: Range of " + std::to_string(length) + " bytes exceeds "
+                                     + std::to_string(MAX_IN_MEMORY_DECODED_SIZE) + "; use decodeRangeInto.");
+        }
+        std::string decoded(length, '\0');
+        decodeRangeInto(offset, length, &decoded[0], num_threads);
+        return decoded;
+    }
+
+    std::string decodeAll(size_t num_threads = 0) const {
+        return decodeRange(0, static_cast<size_t>(original_size), num_threads);
+    }
+};
+
+std::string blockRleDecode(std::string_view encoded, size_t num_threads = 0) {
+    return BlockRleReader(encoded).decodeAll(num_threads);
+}
+
+std::string rleEncode(std::string_view input, RleFormat format) {
+    switch (format) {
+        case RleFormat::Binary: return binaryRleEncode(input);
+        case RleFormat::Block: return blockRleEncode(input);
+        default: return advancedRleEncode(input);
+    }
+}
+
+// Формат определяется по заголовку: текстовый RLE всегда начинается с цифры или '-'.
+std::string rleDecode(std::string_view encoded) {
+    if (hasBlockHeader(encoded)) return blockRleDecode(encoded);
+    return hasBinaryHeader(encoded) ? binaryRleDecode(encoded) : advancedRleDecode(encoded);
+}
+
+// Размер буфера для rleDecodeInto. Для текстового и двоичного форматов он подтвержден проходом по токенам;
+// для блочного берется из индекса и сверяется с токенами только при декодировании, поэтому для
+// недоверенных данных его стоит ограничить перед выделением памяти.
+size_t rleDecodedSize(std::string_view encoded) {
+    if (hasBlockHeader(encoded)) return static_cast<size_t>(BlockRleReader(encoded).originalSize());
+    return hasBinaryHeader(encoded) ? binaryRleDecodedSize(encoded) : advancedRleDecodedSize(encoded);
+}
+
+size_t rleDecodeInto(std::string_view encoded, char* out, size_t capacity) {
+    if (hasBlockHeader(encoded)) {
+        BlockRleReader reader(encoded);
+        if (reader.originalSize() > capacity) {
+            throw std::runtime_error("RLE Decode: Output buffer too small (" + std::to_string(capacity) + " bytes).");
+        }
+        reader.decodeRangeInto(0, static_cast<size_t>(reader.originalSize()), out);
+        return static_cast<size_t>(reader.originalSize());
     }
+    return hasBinaryHeader(encoded) ? binaryRleDecodeInto(encoded, out, capacity) : advancedRleDecodeInto(encoded, out, capacity);
+}
 
-    std::random_device rd;
-    std::mt19937 rng(rd());
+const size_t STREAM_OUTPUT_BUFFER_SIZE = 64 * 1024;
 
-    std::discrete_distribution<size_t> char_dist(weights.begin(), weights.end());
+// Выходной буфер потоковых кодеков: запись в std::ostream крупными блоками.
+class BufferedSink {
+private:
+    std::ostream& out;
+    std::unique_ptr<char[]> buffer;
+    size_t used;
+    uint64_t total_written;
 
-    std::uniform_real_distribution<double> run_probability_dist(0.0, 1.0);
-    double probability_of_run = 0.20;
-    std::uniform_int_distribution<size_t> run_length_dist(3, 10);
+public:
+    explicit BufferedSink(std::ostream& output)
+        : out(output), buffer(new char[STREAM_OUTPUT_BUFFER_SIZE]), used(0), total_written(0) {}
 
-    std::string result_text;
-    result_text.reserve(approx_target_chars * 2);
+    // Не меньше length свободных байт подряд; length <= STREAM_OUTPUT_BUFFER_SIZE.
+    char* reserve(size_t length) {
+        if (length > STREAM_OUTPUT_BUFFER_SIZE - used) flush();
+        return buffer.get() + used;
+    }
 
-    size_t current_char_count = 0;
+    void commit(char* end) {
+        size_t length = static_cast<size_t>(end - (buffer.get() + used));
+        used += length;
+        total_written += length;
+    }
 
-    while (current_char_count < approx_target_chars) {
-        size_t char_idx = char_dist(rng);
-        const std::string& selected_char_utf8 = char_pool[char_idx];
+    void write(const char* data, size_t length) {
+        while (length > 0) {
+            size_t part = std::min(length, STREAM_OUTPUT_BUFFER_SIZE - used);
+            if (part == 0) {
+                flush();
+                continue;
+            }
+            std::memcpy(buffer.get() + used, data, part);
+            used += part;
+            total_written += part;
+            data += part;
+            length -= part;
+        }
+    }
 
-        if (run_probability_dist(rng) < probability_of_run && (current_char_count + 3 < approx_target_chars) ) {
-            size_t length_of_run = run_length_dist(rng);
-            length_of_run = std::min(length_of_run, approx_target_chars - current_char_count);
-            if (length_of_run < 3 && current_char_count + length_of_run < approx_target_chars) {
-                 result_text += selected_char_utf8;
-                 current_char_count++;
-            } else if (length_of_run >=3 ){
-                for (size_t k = 0; k < length_of_run; ++k) {
-                    result_text += selected_char_utf8;
-                }
-                current_char_count += length_of_run;
-            } else {
-                 result_text += selected_char_utf8;
-                 current_char_count++;
+    void fill(char value, uint64_t length) {
+        while (length > 0) {
+            size_t part = static_cast<size_t>(std::min<uint64_t>(length, STREAM_OUTPUT_BUFFER_SIZE - used));
+            if (part == 0) {
+                flush();
+                continue;
             }
-        } else {
-            result_text += selected_char_utf8;
-            current_char_count++;
+            std::memset(buffer.get() + used, static_cast<unsigned char>(value), part);
+            used += part;
+            total_written += part;
+            length -= part;
         }
     }
 
-    std::ofstream outfile(filename, std::ios::binary);
-    if (outfile.is_open()) {
-        outfile.write(result_text.data(), result_text.length());
-        outfile.close();
-        std::cout << "Сгенерирован файл '" << filename << "' (сгенерировано " << current_char_count
-                  << " UTF-8 симв., размер файла " << result_text.length() << " байт)." << std::endl;
-    } else {
-        std::cerr << "Не удалось создать файл для генерации: " << filename << std::endl;
+    void flush() {
+        if (used > 0) {
+            out.write(buffer.get(), static_cast<std::streamsize>(used));
+            used = 0;
+        }
+        if (!out) {
+            throw std::runtime_error("RLE: Failed to write output stream.");
+        }
     }
-    return result_text;
-}*/
 
-std::string advancedRleEncode(const std::string& input) {
-    if (input.empty()) return "";
+    uint64_t totalWritten() const {
+        return total_written;
+    }
+};
 
-    std::stringstream encoded_ss;
-    size_t i = 0;
-    const size_t n = input.length();
-    const char SEPARATOR = '#';
+// Потоковый кодировщик двоичного RLE: вход подается частями через feed(), finish() дописывает хвост.
+// Память постоянна: между частями хранится только незакрытая серия и литерал не длиннее MAX_STREAM_LITERAL.
+// Результат совпадает с binaryRleEncode, пока литералы короче MAX_STREAM_LITERAL; длинные литералы делятся.
+class StreamingRleEncoder {
+public:
+    static constexpr size_t MAX_STREAM_LITERAL = 64 * 1024;
 
-    while (i < n) {
-        char current_char = input[i];
-        size_t count = 1;
-        size_t j = i + 1;
-        while (j < n && input[j] == current_char) {
-            count++;
-            j++;
+private:
+    BufferedSink sink;
+    uint64_t declared_size;
+    uint64_t consumed;
+    std::unique_ptr<char[]> literal;
+    size_t literal_size;
+    char run_value;
+    uint64_t run_length; // 0 - открытой серии нет
+    bool finished;
+
+    void flushLiteral() {
+        if (literal_size == 0) return;
+        sink.commit(writeVarint(sink.reserve(MAX_VARINT_BYTES), static_cast<uint64_t>(literal_size) << 1));
+        sink.write(literal.get(), literal_size);
+        literal_size = 0;
+    }
+
+    void appendLiteral(const char* data, size_t length) {
+        while (length > 0) {
+            size_t part = std::min(length, MAX_STREAM_LITERAL - literal_size);
+            std::memcpy(literal.get() + literal_size, data, part);
+            literal_size += part;
+            data += part;
+            length -= part;
+            if (literal_size == MAX_STREAM_LITERAL) flushLiteral();
         }
+    }
 
-        if (count >= MIN_RUN_LENGTH) {
-            encoded_ss << std::to_string(count) << SEPARATOR << current_char;
-            i = j;
+    void emitRun(char value, uint64_t length) {
+        if (length >= static_cast<uint64_t>(MIN_RUN_LENGTH)) {
+            flushLiteral();
+            char* write = writeVarint(sink.reserve(MAX_VARINT_BYTES + 1), (length << 1) | 1);
+            *write++ = value;
+            sink.commit(write);
         } else {
-            size_t literal_start = i;
-            size_t k = i;
-            while(k < n) {
-                char check_char_literal = input[k];
-                size_t run_len_ahead = 0;
-                size_t temp_k = k;
-                while(temp_k < n && input[temp_k] == check_char_literal) {
-                    run_len_ahead++;
-                    temp_k++;
-                }
-                if (run_len_ahead >= MIN_RUN_LENGTH) {
-                    break;
-                }
-                k += run_len_ahead;
-            }
-            size_t literal_length = k - literal_start;
-            if (literal_length > 0) {
-                encoded_ss << "-" << std::to_string(literal_length) << SEPARATOR;
-                encoded_ss << input.substr(literal_start, literal_length);
-            }
-            i = k;
+            const char bytes[MIN_RUN_LENGTH] = {value, value, value};
+            appendLiteral(bytes, static_cast<size_t>(length));
         }
     }
-    return encoded_ss.str();
-}
-
-std::string advancedRleDecode(const std::string& encoded_input) {
-    if (encoded_input.empty()) return "";
-
-    std::stringstream decoded_ss;
-    size_t i = 0;
-    const size_t n = encoded_input.length();
-    const char SEPARATOR = '#';
 
-    while (i < n) {
-        char first_byte_of_seq = encoded_input[i];
-        bool is_negative_run = false;
+public:
+    explicit StreamingRleEncoder(std::ostream& output, uint64_t original_size = UNKNOWN_ORIGINAL_SIZE)
+        : sink(output), declared_size(original_size), consumed(0), literal(new char[MAX_STREAM_LITERAL]),
+          literal_size(0), run_value(0), run_length(0), finished(false) {
+        char* header = sink.reserve(BINARY_HEADER_SIZE);
+        writeBinaryHeader(header, original_size);
+        sink.commit(header + BINARY_HEADER_SIZE);
+    }
 
-        if (first_byte_of_seq == '-') {
-            is_negative_run = true;
-            i++;
-            if (i >= n || !std::isdigit(static_cast<unsigned char>(encoded_input[i]))) {
-                 throw std::runtime_error("RLE Decode: '-' not followed by a digit or EOF.");
-            }
-        } else if (!std::isdigit(static_cast<unsigned char>(first_byte_of_seq))) {
-            throw std::runtime_error("RLE Decode: Sequence does not start with '-' or digit. Found: '" + std::string(1,first_byte_of_seq) + "' at position " + std::to_string(i));
+    void feed(std::string_view chunk) {
+        if (finished) {
+            throw std::runtime_error("RLE: feed() after finish().");
         }
-
-        std::string num_str;
-        while (i < n && std::isdigit(static_cast<unsigned char>(encoded_input[i]))) {
-            num_str += encoded_input[i];
-            i++;
+        consumed += chunk.size();
+        const char* data = chunk.data();
+        size_t n = chunk.size();
+        size_t pos = 0;
+        if (n == 0) return;
+
+        // продолжение серии, открытой в предыдущей части
+        if (run_length > 0) {
+            while (pos < n && data[pos] == run_value) pos++;
+            run_length += pos;
+            if (pos == n) return;
+            emitRun(run_value, run_length);
+            run_length = 0;
         }
 
-        if (i >= n || encoded_input[i] != SEPARATOR) {
-            throw std::runtime_error("RLE Decode: Missing separator '" + std::string(1, SEPARATOR) + "' after number at pos ~" + std::to_string(i) + " (num_str was " + num_str + ")");
+        // последняя серия части может продолжиться в следующей: она остается открытой
+        size_t tail_start = n - 1;
+        while (tail_start > pos && data[tail_start - 1] == data[n - 1]) {
+            tail_start--;
         }
-        i++;
+        forEachRleSegment(chunk.substr(pos, tail_start - pos), [&](size_t offset, size_t length) {
+            appendLiteral(data + pos + offset, length);
+        }, [&](char value, size_t length) {
+            emitRun(value, length);
+        });
+        run_value = data[n - 1];
+        run_length = n - tail_start;
+    }
 
-        if (num_str.empty()) {
-            throw std::runtime_error("RLE Decode: Failed to read number for length/count.");
+    // Закрывает поток; возвращает размер закодированных данных вместе с заголовком.
+    uint64_t finish() {
+        if (finished) return sink.totalWritten();
+        if (run_length > 0) {
+            emitRun(run_value, run_length);
+            run_length = 0;
         }
+        flushLiteral();
+        finished = true;
+        sink.flush();
+        if (declared_size != UNKNOWN_ORIGINAL_SIZE && consumed != declared_size) {
+            throw std::runtime_error("RLE: Input size " + std::to_string(consumed) + " does not match declared size " + std::to_string(declared_size) + ".");
+        }
+        return sink.totalWritten();
+    }
+};
 
-        int count_or_length = 0;
-        try {
-            count_or_length = std::stoi(num_str);
-        } catch (const std::out_of_range& oor) {
-            throw std::runtime_error("RLE Decode: Number '" + num_str + "' out of range for int.");
-        } catch (const std::invalid_argument& ia) {
-             throw std::runtime_error("RLE Decode: Number '" + num_str + "' is not a valid integer.");
+// Потоковый декодер двоичного RLE: закодированные данные подаются частями произвольной длины;
+// заголовок, varint длины и литералы могут обрываться на границе части.
+class StreamingRleDecoder {
+private:
+    enum class State { Header, Length, RunValue, Literal };
+
+    BufferedSink sink;
+    State state;
+    char header[BINARY_HEADER_SIZE];
+    size_t header_filled;
+    uint64_t original_size;
+    uint64_t token;
+    unsigned token_shift;
+    uint64_t remaining; // длина текущей серии или оставшаяся часть литерала
+    uint64_t encoded_offset;
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("RLE Decode: " + message + " at encoded offset " + std::to_string(encoded_offset) + ".");
+    }
+
+public:
+    explicit StreamingRleDecoder(std::ostream& output)
+        : sink(output), state(State::Header), header_filled(0), original_size(UNKNOWN_ORIGINAL_SIZE),
+          token(0), token_shift(0), remaining(0), encoded_offset(0) {}
+
+    void feed(std::string_view chunk) {
+        size_t pos = 0;
+        while (pos < chunk.size()) {
+            switch (state) {
+                case State::Header: {
+                    size_t part = std::min(chunk.size() - pos, BINARY_HEADER_SIZE - header_filled);
+                    std::memcpy(header + header_filled, chunk.data() + pos, part);
+                    header_filled += part;
+                    pos += part;
+                    if (header_filled == BINARY_HEADER_SIZE) {
+                        original_size = readBinaryHeader(std::string_view(header, BINARY_HEADER_SIZE));
+                        state = State::Length;
+                    }
+                    break;
+                }
+                case State::Length: {
+                    uint8_t byte = static_cast<uint8_t>(chunk[pos++]);
+                    if (token_shift == 63 && byte > 1) fail("Length longer than 64 bits");
+                    token |= static_cast<uint64_t>(byte & 0x7F) << token_shift;
+                    token_shift += 7;
+                    if (byte & 0x80) break;
+                    remaining = token >> 1;
+                    if (remaining == 0) fail("Zero-length token");
+                    if (original_size != UNKNOWN_ORIGINAL_SIZE && remaining > original_size - sink.totalWritten()) {
+                        fail("Token exceeds header size " + std::to_string(original_size));
+                    }
+                    state = (token & 1) ? State::RunValue : State::Literal;
+                    token = 0;
+                    token_shift = 0;
+                    break;
+                }
+                case State::RunValue:
+                    sink.fill(chunk[pos++], remaining);
+                    state = State::Length;
+                    break;
+                case State::Literal: {
+                    size_t part = static_cast<size_t>(std::min<uint64_t>(remaining, chunk.size() - pos));
+                    sink.write(chunk.data() + pos, part);
+                    pos += part;
+                    remaining -= part;
+                    if (remaining == 0) state = State::Length;
+                    break;
+                }
+            }
         }
+        encoded_offset += chunk.size();
+    }
 
-        if (count_or_length <= 0) {
-             throw std::runtime_error("RLE Decode: Invalid count/length (<=0): " + std::to_string(count_or_length));
+    // Проверяет, что поток не оборван; возвращает размер декодированных данных.
+    uint64_t finish() {
+        if (state == State::Header) fail("Missing binary RLE header");
+        if (state != State::Length || token_shift != 0) fail("Truncated token");
+        sink.flush();
+        if (original_size != UNKNOWN_ORIGINAL_SIZE && sink.totalWritten() != original_size) {
+            fail("Decoded size " + std::to_string(sink.totalWritten()) + " does not match header size " + std::to_string(original_size));
         }
+        return sink.totalWritten();
+    }
+};
 
-        if (is_negative_run) {
-            if (i + count_or_length > n) {
-                throw std::runtime_error("RLE Decode: Not enough data for literal sequence. Expected " + std::to_string(count_or_length) + ", available " + std::to_string(n-i));
-            }
-            decoded_ss << encoded_input.substr(i, count_or_length);
-            i += count_or_length;
-        } else {
-            if (i >= n) {
-                 throw std::runtime_error("RLE Decode: Missing char_to_repeat after count and separator.");
-            }
-            char char_to_repeat = encoded_input[i];
-            i++;
-            for (int k_rep = 0; k_rep < count_or_length; ++k_rep) {
-                decoded_ss << char_to_repeat;
-            }
+// Читает файл блоками по chunk_size байт и передает их codec.feed(); память не зависит от размера файла.
+template<typename Codec>
+uint64_t streamFileThrough(const std::string& input_path, Codec& codec, size_t chunk_size) {
+    std::ifstream in(input_path, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("Не удалось открыть файл: " + input_path);
+    }
+    std::unique_ptr<char[]> buffer(new char[chunk_size]);
+    while (in) {
+        in.read(buffer.get(), static_cast<std::streamsize>(chunk_size));
+        if (in.bad()) {
+            throw std::runtime_error("Ошибка чтения файла: " + input_path);
         }
+        codec.feed(std::string_view(buffer.get(), static_cast<size_t>(in.gcount())));
     }
-    return decoded_ss.str();
+    return codec.finish();
+}
+
+// Сжимает файл в двоичный RLE; возвращает размер результата.
+uint64_t compressFile(const std::string& input_path, const std::string& output_path, size_t chunk_size = STREAM_CHUNK_SIZE) {
+    uint64_t original_size = fileSizeBytes(input_path);
+    std::ofstream out(output_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Не удалось открыть файл для записи: " + output_path);
+    }
+    StreamingRleEncoder encoder(out, original_size);
+    return streamFileThrough(input_path, encoder, chunk_size);
+}
+
+// Восстанавливает файл, сжатый compressFile; возвращает размер восстановленных данных.
+uint64_t decompressFile(const std::string& input_path, const std::string& output_path, size_t chunk_size = STREAM_CHUNK_SIZE) {
+    std::ofstream out(output_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Не удалось открыть файл для записи: " + output_path);
+    }
+    StreamingRleDecoder decoder(out);
+    return streamFileThrough(input_path, decoder, chunk_size);
 }
 
 }
@@ -1124,7 +5793,7 @@ void generateFanoCodes(std::vector<FanoNode*>& nodes, int start, int end, std::s
     }
 }
 
-std::map<char, std::string> buildFanoCodes(const std::string& text) {
+std::map<char, std::string> buildFanoCodes(std::string_view text) {
     std::map<char, double> frequencies;
     if (text.empty()) {
         return {};
@@ -1155,7 +5824,7 @@ std::map<char, std::string> buildFanoCodes(const std::string& text) {
     return codes;
 }
 
-std::string encodeFano(const std::string& text, const std::map<char, std::string>& codes) {
+std::string encodeFano(std::string_view text, const std::map<char, std::string>& codes) {
     std::string encoded_bit_string;
     if (text.empty() || codes.empty()) return encoded_bit_string;
 
@@ -1205,6 +5874,13 @@ std::string decodeFano(const std::string& encoded_bit_string, const std::map<cha
 void handleHashTableDictionary();
 void handleRBTreeDictionary();
 void handleRleOperations();
+void handleFlatHashTableDictionary();
+void handleConcurrentDictionary();
+void handleSnapshotDictionary();
+void handleBPlusTreeDictionary();
+void handleVersionedDictionary();
+void handleArtDictionary();
+void handleBenchmarks();
 
 template<typename DictType>
 void dictionarySubMenuLoop(DictType& dictionary, const std::string& dict_name);
@@ -1214,6 +5890,13 @@ void printMainMenu() {
     std::cout << "1. Работать со словарем на Хеш-таблице" << std::endl;
     std::cout << "2. Работать со словарем на Красно-Черном дереве" << std::endl;
     std::cout << "3. RLE кодирование/декодирование текста" << std::endl;
+    std::cout << "4. Работать со словарем на Хеш-таблице с открытой адресацией" << std::endl;
+    std::cout << "5. Работать с многопоточным словарем (шардированная Хеш-таблица)" << std::endl;
+    std::cout << "6. Бенчмарки" << std::endl;
+    std::cout << "7. Работать со словарем-снимком (RCU, чтение без блокировок)" << std::endl;
+    std::cout << "8. Работать со словарем на B+-дереве" << std::endl;
+    std::cout << "9. Работать с версионным словарем (персистентное КЧ-дерево)" << std::endl;
+    std::cout << "10. Работать со словарем на адаптивном префиксном дереве (ART)" << std::endl;
     std::cout << "0. Выход" << std::endl;
     std::cout << "Ваш выбор: ";
 }
@@ -1228,6 +5911,7 @@ void printDictionaryMenu(const std::string& dictionary_type) {
     std::cout << "6. Очистить словарь" << std::endl;
     std::cout << "7. Показать текущее содержимое словаря (стандартный print)" << std::endl;
     std::cout << "8. Визуализировать структуру" << std::endl;
+    std::cout << "9. Дополнить словарь из нескольких файлов (параллельно)" << std::endl;
     std::cout << "0. Вернуться в главное меню" << std::endl;
     std::cout << "Ваш выбор: ";
 }
@@ -1239,6 +5923,21 @@ void printRleMenu() { // Новое название, если старое ис
     std::cout << "3. Двухступенчатый RLE -> Фано (генерация текста)" << std::endl;
     std::cout << "4. RLE для файла 'sample_text_rus.txt'" << std::endl;
     std::cout << "5. Фано для файла 'sample_text_rus.txt'" << std::endl;
+    std::cout << "6. Текстовый и двоичный форматы RLE для файла 'sample_text_rus.txt'" << std::endl;
+    std::cout << "7. Потоковое сжатие файла (двоичный RLE)" << std::endl;
+    std::cout << "8. Потоковое восстановление файла (двоичный RLE)" << std::endl;
+    std::cout << "9. Блочный RLE для файла 'sample_text_rus.txt' и чтение фрагмента" << std::endl;
+    std::cout << "0. Вернуться в главное меню" << std::endl;
+    std::cout << "Ваш выбор: ";
+}
+
+void printBenchmarkMenu() {
+    std::cout << "\n--- Меню Бенчмарков ---" << std::endl;
+    std::cout << "1. Масштабирование многопоточного подсчета слов (слов/сек от числа потоков)" << std::endl;
+    std::cout << "2. Упорядоченные словари: КЧ-дерево, B+-дерево и ART" << std::endl;
+    std::cout << "3. Читатели версионного словаря во время записи (поисков/сек от числа читателей)" << std::endl;
+    std::cout << "4. Параллельная загрузка набора файлов (map-reduce, слов/сек от числа потоков)" << std::endl;
+    std::cout << "5. RLE: текстовый, двоичный и блочный форматы, сжатие и скорость (МБ/с)" << std::endl;
     std::cout << "0. Вернуться в главное меню" << std::endl;
     std::cout << "Ваш выбор: ";
 }
@@ -1265,7 +5964,7 @@ int main() {
     int main_choice;
     do {
         printMainMenu();
-        main_choice = getUserChoice(0, 3);
+        main_choice = getUserChoice(0, 10);
 
         switch (main_choice) {
             case 1:
@@ -1277,6 +5976,27 @@ int main() {
             case 3:
                 handleRleOperations();
                 break;
+            case 4:
+                handleFlatHashTableDictionary();
+                break;
+            case 5:
+                handleConcurrentDictionary();
+                break;
+            case 6:
+                handleBenchmarks();
+                break;
+            case 7:
+                handleSnapshotDictionary();
+                break;
+            case 8:
+                handleBPlusTreeDictionary();
+                break;
+            case 9:
+                handleVersionedDictionary();
+                break;
+            case 10:
+                handleArtDictionary();
+                break;
             case 0:
                 std::cout << "Выход из программы." << std::endl;
                 break;
@@ -1289,10 +6009,46 @@ int main() {
 
 void handleHashTableDictionary() {
     using namespace DictionaryWithHashTable;
-    static Dictionary dict_ht;
+    static Dictionary<> dict_ht;
     dictionarySubMenuLoop(dict_ht, "Хеш-таблица");
 }
 
+void handleFlatHashTableDictionary() {
+    using namespace DictionaryWithHashTable;
+    static Dictionary<FlatHashTable> dict_flat;
+    dictionarySubMenuLoop(dict_flat, "Хеш-таблица с открытой адресацией");
+}
+
+void handleConcurrentDictionary() {
+    using namespace DictionaryWithHashTable;
+    static ConcurrentDictionary dict_concurrent;
+    dictionarySubMenuLoop(dict_concurrent, "Шардированная хеш-таблица");
+}
+
+void handleSnapshotDictionary() {
+    using namespace DictionaryWithHashTable;
+    static SnapshotDictionary dict_snapshot;
+    dictionarySubMenuLoop(dict_snapshot, "Снимки хеш-таблицы (RCU)");
+}
+
+void handleBPlusTreeDictionary() {
+    using namespace DictionaryWithBPlusTree;
+    static Dictionary dict_bplus;
+    dictionarySubMenuLoop(dict_bplus, "B+-дерево");
+}
+
+void handleVersionedDictionary() {
+    using namespace DictionaryWithRBTree;
+    static VersionedDictionary dict_versioned;
+    dictionarySubMenuLoop(dict_versioned, "Версии КЧ-дерева");
+}
+
+void handleArtDictionary() {
+    using namespace DictionaryWithART;
+    static Dictionary dict_art;
+    dictionarySubMenuLoop(dict_art, "ART");
+}
+
 void handleRBTreeDictionary() {
     using namespace DictionaryWithRBTree;
     static Dictionary dict_rbt;
@@ -1306,7 +6062,7 @@ void dictionarySubMenuLoop(DictType& dictionary, const std::string& dict_name) {
 
     do {
         printDictionaryMenu(dict_name);
-        dict_choice = getUserChoice(0, 8);
+        dict_choice = getUserChoice(0, 9);
 
         try {
             switch (dict_choice) {
@@ -1348,6 +6104,18 @@ void dictionarySubMenuLoop(DictType& dictionary, const std::string& dict_name) {
                 case 8:
                     dictionary.visualizeStructure();
                     break;
+                case 9:
+                    {
+                        std::cout << "Введите имена файлов через пробел: ";
+                        std::getline(std::cin, filepath);
+                        std::istringstream names(filepath);
+                        std::vector<std::string> filepaths;
+                        for (std::string name; names >> name;) {
+                            filepaths.push_back(name);
+                        }
+                        dictionary.loadFromFiles(filepaths, true);
+                    }
+                    break;
                 case 0:
                     std::cout << "Возврат в главное меню..." << std::endl;
                     break;
@@ -1362,7 +6130,6 @@ void dictionarySubMenuLoop(DictType& dictionary, const std::string& dict_name) {
 void handleRleOperations() {
     int rle_choice;
     std::string filename;
-    std::string text_to_process;
 
     auto print_compression_ratio = [](const std::string& stage_name, size_t original_size, size_t compressed_size) {
         if (compressed_size > 0) {
@@ -1379,7 +6146,7 @@ void handleRleOperations() {
 
     do {
         printRleMenu();
-        rle_choice = getUserChoice(0, 5);
+        rle_choice = getUserChoice(0, 9);
 
         try {
             switch (rle_choice) {
@@ -1514,7 +6281,8 @@ void handleRleOperations() {
                 case 4:
                     std::cout << "Обработка файла 'sample_text_rus.txt'..." << std::endl;
                     try {
-                        text_to_process = readFileToString("sample_text_rus.txt");
+                        MappedFile input_file("sample_text_rus.txt");
+                        std::string_view text_to_process = input_file.view();
                         std::cout << "Исходный текст из файла: " << text_to_process.substr(0, std::min((size_t)50, text_to_process.length())) << "..." << std::endl;
                         std::string encoded = RLE::advancedRleEncode(text_to_process);
                         std::cout << "Закодировано RLE: " << encoded.substr(0, std::min((size_t)50, encoded.length())) << "..." << std::endl;
@@ -1532,7 +6300,8 @@ void handleRleOperations() {
                 case 5:
                     std::cout << "Обработка файла 'sample_text_rus.txt'..." << std::endl;
                     try {
-                        text_to_process = readFileToString("sample_text_rus.txt");
+                        MappedFile input_file("sample_text_rus.txt");
+                        std::string_view text_to_process = input_file.view();
                         std::cout << "Исходный текст из файла: " << text_to_process.substr(0, std::min((size_t)50, text_to_process.length())) << "..." << std::endl;
                         std::map<char, std::string> fano_codes = Fano::buildFanoCodes(text_to_process);
                         std::string fano_encoded_bit_string = Fano::encodeFano(text_to_process, fano_codes);
@@ -1555,6 +6324,64 @@ void handleRleOperations() {
                          std::cerr << "Ошибка при работе с файлом 'sample_text_rus.txt': " << e_file.what() << std::endl;
                     }
                     break;
+                case 6:
+                    std::cout << "Обработка файла 'sample_text_rus.txt'..." << std::endl;
+                    try {
+                        MappedFile input_file("sample_text_rus.txt");
+                        std::string_view text_to_process = input_file.view();
+                        for (RLE::RleFormat format : {RLE::RleFormat::Text, RLE::RleFormat::Binary}) {
+                            const char* format_name = format == RLE::RleFormat::Text ? "текстовый" : "двоичный";
+                            std::string encoded = RLE::rleEncode(text_to_process, format);
+                            std::cout << "RLE (" << format_name << "): " << text_to_process.length() << " -> " << encoded.length() << " байт";
+                            if (!encoded.empty()) {
+                                std::cout << ", коэффициент " << std::fixed << std::setprecision(2)
+                                          << static_cast<double>(text_to_process.length()) / encoded.length();
+                            }
+                            std::cout << (RLE::rleDecode(encoded) == text_to_process ? ", декодирование ВЕРНО." : ", ОШИБКА декодирования!") << std::endl;
+                        }
+                    } catch (const std::runtime_error& e_file) {
+                         std::cerr << "Ошибка при работе с файлом 'sample_text_rus.txt': " << e_file.what() << std::endl;
+                    }
+                    break;
+                case 7:
+                case 8:
+                    {
+                        std::string output_filename;
+                        std::cout << "Введите имя исходного файла: ";
+                        std::getline(std::cin, filename);
+                        std::cout << "Введите имя файла результата: ";
+                        std::getline(std::cin, output_filename);
+                        if (rle_choice == 7) {
+                            uint64_t compressed_size = RLE::compressFile(filename, output_filename);
+                            std::cout << "Файл '" << filename << "' (" << fileSizeBytes(filename) << " байт) сжат в '"
+                                      << output_filename << "' (" << compressed_size << " байт)." << std::endl;
+                        } else {
+                            uint64_t restored_size = RLE::decompressFile(filename, output_filename);
+                            std::cout << "Файл '" << filename << "' восстановлен в '" << output_filename << "' ("
+                                      << restored_size << " байт)." << std::endl;
+                        }
+                    }
+                    break;
+                case 9:
+                    {
+                        const size_t DEMO_BLOCK_SIZE = 128; // маленькие блоки, чтобы короткий файл разбился на несколько
+                        MappedFile input_file("sample_text_rus.txt");
+                        std::string_view text_to_process = input_file.view();
+                        std::string encoded = RLE::blockRleEncode(text_to_process, DEMO_BLOCK_SIZE);
+                        RLE::BlockRleReader reader(encoded);
+                        std::cout << "Блочный RLE: " << text_to_process.length() << " -> " << encoded.length() << " байт, блоков: "
+                                  << reader.blockCount() << " по " << DEMO_BLOCK_SIZE << " байт." << std::endl;
+                        std::cout << (reader.decodeAll() == text_to_process ? "Полное декодирование ВЕРНО." : "ОШИБКА полного декодирования!") << std::endl;
+
+                        std::cout << "Введите смещение фрагмента: ";
+                        size_t offset = static_cast<size_t>(getUserChoice(0, static_cast<int>(text_to_process.length())));
+                        std::cout << "Введите длину фрагмента: ";
+                        size_t length = static_cast<size_t>(getUserChoice(0, static_cast<int>(text_to_process.length() - offset)));
+                        std::string fragment = reader.decodeRange(offset, length);
+                        std::cout << "Фрагмент: " << fragment << std::endl;
+                        std::cout << (fragment == text_to_process.substr(offset, length) ? "Фрагмент совпадает с исходным текстом." : "ОШИБКА: фрагмент не совпадает!") << std::endl;
+                    }
+                    break;
                 case 0:
                     std::cout << "Возврат в главное меню..." << std::endl;
                     break;
@@ -1566,3 +6393,323 @@ void handleRleOperations() {
 }
 
 
+// Синтетический корпус: словарь из случайных русских "слов", частоты распределены по закону Ципфа.
+std::vector<std::string> generateBenchmarkWords(size_t num_words, size_t vocabulary_size) {
+    const std::vector<std::string> RUS_LOWER = {
+        "а", "б", "в", "г", "д", "е", "ж", "з", "и", "й", "к", "л", "м",
+        "н", "о", "п", "р", "с", "т", "у", "ф", "х", "ц", "ч", "ш", "щ",
+        "ы", "э", "ю", "я"
+    };
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<size_t> letter_dist(0, RUS_LOWER.size() - 1);
+    std::uniform_int_distribution<size_t> length_dist(3, 12);
+
+    std::vector<std::string> vocabulary;
+    vocabulary.reserve(vocabulary_size);
+    std::vector<double> weights;
+    weights.reserve(vocabulary_size);
+    for (size_t rank = 1; rank <= vocabulary_size; ++rank) {
+        std::string word;
+        size_t length = length_dist(rng);
+        for (size_t i = 0; i < length; ++i) {
+            word += RUS_LOWER[letter_dist(rng)];
+        }
+        vocabulary.push_back(word);
+        weights.push_back(1.0 / static_cast<double>(rank));
+    }
+
+    std::discrete_distribution<size_t> word_dist(weights.begin(), weights.end());
+    std::vector<std::string> words;
+    words.reserve(num_words);
+    for (size_t i = 0; i < num_words; ++i) {
+        words.push_back(vocabulary[word_dist(rng)]);
+    }
+    return words;
+}
+
+double measureSeconds(const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void benchmarkConcurrentCounting() {
+    const size_t NUM_WORDS = 4000000;
+    const size_t VOCABULARY_SIZE = 200000;
+    std::cout << "Генерация корпуса (" << NUM_WORDS << " слов, словарь " << VOCABULARY_SIZE << ")..." << std::endl;
+    std::vector<std::string> words = generateBenchmarkWords(NUM_WORDS, VOCABULARY_SIZE);
+
+    double single_seconds = measureSeconds([&words]() {
+        DictionaryWithHashTable::Dictionary<> dict;
+        for (const std::string& word : words) dict.addWord(word);
+    });
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Однопоточный Dictionary: " << single_seconds << " с, "
+              << NUM_WORDS / single_seconds / 1e6 << " млн слов/с" << std::endl;
+
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < defaultThreadCount(); threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(defaultThreadCount());
+
+    for (size_t threads : thread_counts) {
+        double seconds = measureSeconds([&words, threads]() {
+            DictionaryWithHashTable::ConcurrentDictionary dict;
+            dict.countWords(words, threads);
+        });
+        std::cout << "ConcurrentDictionary, потоков: " << threads << ": " << seconds << " с, "
+                  << NUM_WORDS / seconds / 1e6 << " млн слов/с, ускорение x" << single_seconds / seconds << std::endl;
+    }
+}
+
+void benchmarkOrderedDictionaries() {
+    const size_t NUM_WORDS = 2000000;
+    const size_t VOCABULARY_SIZE = 300000;
+    std::cout << "Генерация корпуса (" << NUM_WORDS << " слов, словарь " << VOCABULARY_SIZE << ")..." << std::endl;
+    std::vector<std::string> words = generateBenchmarkWords(NUM_WORDS, VOCABULARY_SIZE);
+
+    DictionaryWithRBTree::RBTree rbt;
+    DictionaryWithBPlusTree::BPlusTree bpt;
+    DictionaryWithART::AdaptiveRadixTree art;
+    double rbt_build = measureSeconds([&]() {
+        for (const std::string& word : words) {
+            rbt.increment(word);
+        }
+    });
+    double bpt_build = measureSeconds([&]() {
+        for (const std::string& word : words) bpt.findOrInsert(word)++;
+    });
+    double art_build = measureSeconds([&]() {
+        for (const std::string& word : words) art.findOrInsert(word)++;
+    });
+
+    long long checksum_rbt = 0, checksum_bpt = 0, checksum_art = 0;
+    double rbt_lookup = measureSeconds([&]() {
+        for (const std::string& word : words) checksum_rbt += *rbt.search(word);
+    });
+    double bpt_lookup = measureSeconds([&]() {
+        for (const std::string& word : words) checksum_bpt += *bpt.search(word);
+    });
+    double art_lookup = measureSeconds([&]() {
+        for (const std::string& word : words) checksum_art += *art.search(word);
+    });
+
+    std::ostringstream rbt_dump, bpt_dump, art_dump;
+    double rbt_print = measureSeconds([&]() { rbt.print(rbt_dump); });
+    double bpt_print = measureSeconds([&]() { bpt.print(bpt_dump); });
+    double art_print = measureSeconds([&]() { art.print(art_dump); });
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Построение:        КЧ-дерево " << rbt_build << " с, B+-дерево " << bpt_build << " с, ART "
+              << art_build << " с" << std::endl;
+    std::cout << "Точечный поиск:    КЧ-дерево " << rbt_lookup << " с, B+-дерево " << bpt_lookup << " с"
+              << " (ускорение x" << rbt_lookup / bpt_lookup << "), ART " << art_lookup << " с"
+              << " (ускорение x" << rbt_lookup / art_lookup << ")" << std::endl;
+    std::cout << "Упорядоченный вывод: КЧ-дерево " << rbt_print << " с, B+-дерево " << bpt_print << " с, ART "
+              << art_print << " с" << std::endl;
+    std::cout << "Память:            КЧ-дерево " << rbt.memoryUsage() / 1024 << " КБ, ART "
+              << art.memoryUsage() / 1024 << " КБ" << std::endl;
+    if (checksum_rbt != checksum_bpt || checksum_rbt != checksum_art) {
+        std::cout << "ОШИБКА: результаты поиска расходятся!" << std::endl;
+    }
+}
+
+// Писатель непрерывно публикует новые версии, читатели ищут слова в своих снимках без блокировок.
+void benchmarkVersionedReaders() {
+    const size_t NUM_WORDS = 1000000;
+    const size_t VOCABULARY_SIZE = 100000;
+    const size_t LOOKUPS_PER_SNAPSHOT = 1000;
+    const auto RUN_TIME = std::chrono::milliseconds(500);
+    std::cout << "Генерация корпуса (" << NUM_WORDS << " слов, словарь " << VOCABULARY_SIZE << ")..." << std::endl;
+    std::vector<std::string> words = generateBenchmarkWords(NUM_WORDS, VOCABULARY_SIZE);
+
+    std::vector<size_t> reader_counts;
+    for (size_t readers = 1; readers < defaultThreadCount(); readers *= 2) {
+        reader_counts.push_back(readers);
+    }
+    reader_counts.push_back(defaultThreadCount());
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (size_t readers : reader_counts) {
+        DictionaryWithRBTree::VersionedDictionary dict;
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> total_lookups{0};
+        size_t versions_written = 0;
+
+        std::thread writer([&]() {
+            for (size_t i = 0; !stop.load(std::memory_order_relaxed); i = (i + 1) % words.size()) {
+                dict.addWord(words[i]);
+                versions_written++;
+            }
+        });
+        std::vector<std::thread> reader_threads;
+        for (size_t r = 0; r < readers; ++r) {
+            reader_threads.emplace_back([&, r]() {
+                size_t lookups = 0;
+                long long checksum = 0;
+                for (size_t i = r * 7919; !stop.load(std::memory_order_relaxed);) {
+                    DictionaryWithRBTree::VersionedDictionary::Version version = dict.snapshot();
+                    for (size_t j = 0; j < LOOKUPS_PER_SNAPSHOT; ++j, i = (i + 1) % words.size()) {
+                        const int* count_ptr = version.search(words[i]);
+                        checksum += count_ptr ? *count_ptr : 0;
+                    }
+                    lookups += LOOKUPS_PER_SNAPSHOT;
+                }
+                total_lookups.fetch_add(lookups + (checksum < 0 ? 1 : 0));
+            });
+        }
+        std::this_thread::sleep_for(RUN_TIME);
+        stop.store(true);
+        writer.join();
+        for (std::thread& thread : reader_threads) {
+            thread.join();
+        }
+
+        double seconds = std::chrono::duration<double>(RUN_TIME).count();
+        std::cout << "Читателей: " << readers << ": " << total_lookups.load() / seconds / 1e6 << " млн поисков/с, "
+                  << "писатель опубликовал " << versions_written << " версий" << std::endl;
+    }
+}
+
+// Файлы корпуса разного размера (i-й файл в i+1 раз больше первого): перехват работы выравнивает нагрузку.
+void benchmarkMultiFileLoading() {
+    const size_t NUM_FILES = 16;
+    const size_t WORDS_PER_UNIT = 40000;
+    const size_t VOCABULARY_SIZE = 200000;
+    std::vector<std::string> words = generateBenchmarkWords(WORDS_PER_UNIT * NUM_FILES * (NUM_FILES + 1) / 2, VOCABULARY_SIZE);
+    std::vector<std::string> filepaths;
+    size_t next_word = 0;
+    for (size_t i = 0; i < NUM_FILES; ++i) {
+        filepaths.push_back("benchmark_corpus_" + std::to_string(i) + ".txt");
+        std::ofstream out(filepaths.back(), std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Не удалось открыть файл для записи: " + filepaths.back());
+        }
+        for (size_t j = 0; j < WORDS_PER_UNIT * (i + 1); ++j) {
+            out << words[next_word++] << (j % 12 == 11 ? ".\n" : " ");
+        }
+    }
+    std::cout << "Создано файлов: " << NUM_FILES << ", слов: " << words.size() << std::endl;
+
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < defaultThreadCount(); threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(defaultThreadCount());
+
+    std::cout << std::fixed << std::setprecision(2);
+    double single_seconds = 0;
+    for (size_t threads : thread_counts) {
+        long long total = 0;
+        double seconds = measureSeconds([&]() {
+            for (const auto& part : DictionaryWithHashTable::countWordsInFilesParallel(filepaths, threads)) {
+                part.forEach([&total](const DictionaryWithHashTable::HashNode& node) { total += node.value; });
+            }
+        });
+        if (threads == 1) single_seconds = seconds;
+        std::cout << "Потоков: " << threads << ": " << seconds << " с, " << words.size() / seconds / 1e6
+                  << " млн слов/с, ускорение x" << single_seconds / seconds << std::endl;
+        if (total != static_cast<long long>(words.size())) {
+            std::cout << "ОШИБКА: подсчитано " << total << " слов вместо " << words.size() << std::endl;
+        }
+    }
+    for (const std::string& filepath : filepaths) {
+        std::remove(filepath.c_str());
+    }
+}
+
+// Текст с длинными сериями, похожий на журналы телеметрии: выровненные поля, заполненные пробелами и нулями.
+std::string generateRepetitiveText(size_t approx_size) {
+    std::mt19937 rng(2024);
+    std::uniform_int_distribution<size_t> run_length_dist(1, 64);
+    const std::string ALPHABET = " 0-=.abcdef\n";
+    std::uniform_int_distribution<size_t> char_dist(0, ALPHABET.size() - 1);
+    std::string text;
+    text.reserve(approx_size + 64);
+    while (text.size() < approx_size) {
+        text.append(run_length_dist(rng), ALPHABET[char_dist(rng)]);
+    }
+    return text;
+}
+
+void benchmarkRle() {
+    const size_t TEXT_SIZE = 64 * 1024 * 1024;
+    std::string text = generateRepetitiveText(TEXT_SIZE);
+    double megabytes = text.size() / 1e6;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Исходный размер: " << text.size() << " байт" << std::endl;
+    for (RLE::RleFormat format : {RLE::RleFormat::Text, RLE::RleFormat::Binary, RLE::RleFormat::Block}) {
+        std::string encoded;
+        double encode_seconds = measureSeconds([&]() { encoded = RLE::rleEncode(text, format); });
+        std::string decoded;
+        double decode_seconds = measureSeconds([&]() { decoded = RLE::rleDecode(encoded); });
+        // повторное декодирование в уже выделенный буфер: без выделений и первых обращений к страницам
+        double decode_into_seconds = measureSeconds([&]() { RLE::rleDecodeInto(encoded, &decoded[0], decoded.size()); });
+
+        const char* format_name = format == RLE::RleFormat::Text ? "Текстовый RLE: "
+                                : format == RLE::RleFormat::Binary ? "Двоичный RLE:  " : "Блочный RLE:   ";
+        std::cout << format_name << encoded.size()
+                  << " байт (x" << static_cast<double>(text.size()) / encoded.size() << "), кодирование "
+                  << megabytes / encode_seconds << " МБ/с, декодирование " << megabytes / decode_seconds
+                  << " МБ/с, в готовый буфер " << megabytes / decode_into_seconds << " МБ/с" << std::endl;
+        if (decoded != text) {
+            std::cout << "ОШИБКА: декодированный текст не совпадает с исходным!" << std::endl;
+        }
+    }
+
+    // выборочное чтение из блочного контейнера: декодируются только блоки, пересекающие диапазон
+    const size_t RANGE_LENGTH = 4096;
+    const size_t NUM_RANGES = 1000;
+    std::string block_encoded = RLE::blockRleEncode(text);
+    RLE::BlockRleReader reader(block_encoded);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> offset_dist(0, text.size() - RANGE_LENGTH);
+    bool ranges_match = true;
+    double range_seconds = measureSeconds([&]() {
+        for (size_t i = 0; i < NUM_RANGES; ++i) {
+            size_t offset = offset_dist(rng);
+            ranges_match &= reader.decodeRange(offset, RANGE_LENGTH, 1) == std::string_view(text).substr(offset, RANGE_LENGTH);
+        }
+    });
+    std::cout << "Блочный RLE (" << reader.blockCount() << " блоков): чтение " << RANGE_LENGTH << " байт с произвольного смещения - "
+              << range_seconds / NUM_RANGES * 1e6 << " мкс" << std::endl;
+    if (!ranges_match) {
+        std::cout << "ОШИБКА: выборочное чтение не совпадает с исходным текстом!" << std::endl;
+    }
+}
+
+void handleBenchmarks() {
+    int bench_choice;
+    do {
+        printBenchmarkMenu();
+        bench_choice = getUserChoice(0, 5);
+
+        try {
+            switch (bench_choice) {
+                case 1:
+                    benchmarkConcurrentCounting();
+                    break;
+                case 2:
+                    benchmarkOrderedDictionaries();
+                    break;
+                case 3:
+                    benchmarkVersionedReaders();
+                    break;
+                case 4:
+                    benchmarkMultiFileLoading();
+                    break;
+                case 5:
+                    benchmarkRle();
+                    break;
+                case 0:
+                    std::cout << "Возврат в главное меню..." << std::endl;
+                    break;
+            }
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Произошла ошибка: " << e.what() << std::endl;
+        }
+    } while (bench_choice != 0);
+}